@@ -0,0 +1,53 @@
+#ifndef __ADDRESS_LIST_HPP__
+#define __ADDRESS_LIST_HPP__
+
+#include <cstdint>
+
+#include "address_set.hpp"
+
+namespace sandor_laboratories
+{
+  namespace pingo
+  {
+    /* File signature "PINGOSET" to identify a precompiled address list in little endian */
+    #define ADDRESS_LIST_SIGNATURE 0x5445534F474E4950ULL
+
+    typedef enum
+    {
+      ADDRESS_LIST_VERSION_INVALID,
+      ADDRESS_LIST_VERSION_0,
+      ADDRESS_LIST_VERSION_MAX,
+    } address_list_version_e;
+
+    /* Header of a precompiled address list.  Followed by range_count address_range_s, sorted and merged */
+    typedef struct __attribute__ ((packed))
+    {
+      /* Static string "PINGOSET" if valid precompiled address list */
+      uint64_t signature;
+      /* Version of precompiled address list */
+      uint32_t version;
+      /* Number of ranges following the header */
+      uint32_t range_count;
+    } address_list_header_s;
+
+    typedef struct
+    {
+      /* True if the file was a precompiled address list */
+      bool         precompiled;
+      /* CIDR lines added to the set.  Ranges read if precompiled */
+      unsigned int entries;
+      /* Lines which could not be parsed */
+      unsigned int invalid_lines;
+    } address_list_load_stats_s;
+
+    /* Adds every address listed in the file at path to set and compiles it.
+        Text files list one CIDR (###.###.###.### or ###.###.###.###/##) per line, '#' starts a comment.
+        Files starting with ADDRESS_LIST_SIGNATURE are read as precompiled address lists.  Returns false if the file can't be read */
+    bool load_address_list(const char *path, address_set_c *set, address_list_load_stats_s *stats = nullptr);
+
+    /* Writes a compiled set as a precompiled address list.  Returns false if the file can't be written */
+    bool save_address_list(const char *path, const address_set_c *set);
+  }
+}
+
+#endif /* __ADDRESS_LIST_HPP__ */
@@ -0,0 +1,54 @@
+#ifndef __ADDRESS_SET_HPP__
+#define __ADDRESS_SET_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace sandor_laboratories
+{
+  namespace pingo
+  {
+    /* Inclusive range of IPv4 addresses */
+    typedef struct
+    {
+      uint32_t first;
+      uint32_t last;
+    } address_range_s;
+
+    /* Set of IPv4 addresses stored as sorted, merged ranges.  Ranges are added in any order then compiled once,
+        after which lookups are O(log n) in the number of ranges.  Compiled sets are read only and safe to share between threads */
+    class address_set_c
+    {
+      private:
+        std::vector<address_range_s> ranges;
+        bool                         compiled;
+
+      public:
+        address_set_c();
+
+        /* Reserves space for range_count added ranges */
+        inline void     reserve(size_t range_count) {ranges.reserve(range_count);};
+        /* Adds first..last inclusive.  Set must be compiled again before lookups */
+        void            add_range(uint32_t first, uint32_t last);
+        /* Adds every address of the subnet containing address */
+        void            add_subnet(uint32_t address, uint32_t subnet_mask);
+
+        /* Sorts ranges and merges overlapping or adjacent ranges */
+        void            compile();
+        inline bool     is_compiled()     const {return compiled;};
+
+        inline size_t   get_range_count() const {return ranges.size();};
+        inline const address_range_s & get_range(size_t index) const {return ranges[index];};
+        /* Total number of addresses in the set */
+        uint_fast64_t   get_address_count() const;
+
+        /* Index of the first range ending at or after address.  get_range_count() if there is none */
+        size_t          lower_bound(uint32_t address) const;
+        /* Returns true if address is in the set.  range_last is set to the last address of the range containing it */
+        bool            contains(uint32_t address, uint32_t *range_last = nullptr) const;
+    };
+  }
+}
+
+#endif /* __ADDRESS_SET_HPP__ */
@@ -3,8 +3,10 @@
 
 #include <cstdint>
 #include <ctime>
+#include <net/if.h>
 
 #include "pingo.hpp"
+#include "send_engine.hpp"
 
 namespace sandor_laboratories
 {
@@ -19,6 +21,7 @@ namespace sandor_laboratories
     } pingo_argument_status_e;
 
     #define IMAGE_STRING_BUFFER_SIZE 1024
+    #define PINGO_MAX_SEND_THREADS   64
     typedef struct
     {
       pingo_argument_status_e annotate_status;
@@ -46,6 +49,63 @@ namespace sandor_laboratories
 
       pingo_argument_status_e exclude_list_status;
       char                    exclude_list_path[FILE_PATH_MAX_LENGTH];
+      pingo_argument_status_e save_exclude_list_status;
+      char                    save_exclude_list_path[FILE_PATH_MAX_LENGTH];
+
+      pingo_argument_status_e include_list_status;
+      char                    include_list_path[FILE_PATH_MAX_LENGTH];
+
+      pingo_argument_status_e scan_reserved_status;
+
+      pingo_argument_status_e rate_status;
+      uint32_t                rate;
+      pingo_argument_status_e min_rate_status;
+      uint32_t                min_rate;
+      pingo_argument_status_e max_rate_status;
+      uint32_t                max_rate;
+
+      pingo_argument_status_e send_threads_status;
+      unsigned int            send_threads;
+
+      pingo_argument_status_e permute_status;
+      pingo_argument_status_e seed_status;
+      uint64_t                seed;
+
+      pingo_argument_status_e send_backend_status;
+      send_engine_backend_e   send_backend;
+      pingo_argument_status_e interface_status;
+      char                    interface[IF_NAMESIZE];
+      pingo_argument_status_e gateway_mac_status;
+      uint8_t                 gateway_mac[ETHER_ADDR_LEN];
+      pingo_argument_status_e xdp_copy_status;
+
+      pingo_argument_status_e send_buffer_status;
+      unsigned int            send_buffer;
+
+      pingo_argument_status_e tx_timestamps_status;
+
+      pingo_argument_status_e retry_after_status;
+      unsigned int            retry_after;
+
+      pingo_argument_status_e rate_per_24_status;
+      unsigned int            rate_per_24;
+      pingo_argument_status_e rate_per_16_status;
+      unsigned int            rate_per_16;
+
+      pingo_argument_status_e block_duration_status;
+      unsigned int            block_duration;
+
+      pingo_argument_status_e prepare_blocks_status;
+      unsigned int            prepare_blocks;
+
+      pingo_argument_status_e shard_status;
+      unsigned int            shard;
+      unsigned int            shard_count;
+
+      pingo_argument_status_e window_blocks_status;
+      unsigned int            window_blocks;
+      pingo_argument_status_e window_memory_status;
+      unsigned int            window_memory;
 
     } pingo_ping_block_arguments_s;
 
@@ -23,6 +23,9 @@ namespace sandor_laboratories
     {
       FILE_VERSION_INVALID,
       FILE_VERSION_0,
+      /* Adds FILE_DATA_ENTRY_ECHO_REPLY_US and the NOT_INCLUDED and RESERVED skip reasons.
+          Files without such entries are still written as version 0 for older readers */
+      FILE_VERSION_1,
       FILE_VERSION_MAX,
     } file_version_e;
 
@@ -48,6 +51,8 @@ namespace sandor_laboratories
       FILE_DATA_ENTRY_ECHO_REPLY,
       FILE_DATA_ENTRY_ECHO_NO_REPLY,
       FILE_DATA_ENTRY_ECHO_SKIPPED,
+      /* FILE_VERSION_1 and later only */
+      FILE_DATA_ENTRY_ECHO_REPLY_US,
       FILE_DATA_ENTRY_MAX,
     } file_data_entry_type_e;
 
@@ -57,12 +62,23 @@ namespace sandor_laboratories
       /* Echo reply time in ms */
       uint32_t reply_time:24;
     } file_data_entry_payload_echo_reply_s;
+
+    /* Replies slower than this are recorded in ms with FILE_DATA_ENTRY_ECHO_REPLY */
+    #define FILE_ECHO_REPLY_TIME_US_MAX 0x00FFFFFF
+    typedef struct __attribute__ ((packed))
+    {
+      /* Echo reply time in us */
+      uint32_t reply_time_us:24;
+    } file_data_entry_payload_echo_reply_us_s;
     
     typedef enum 
     {
       FILE_DATA_ENTRY_ECHO_SKIP_REASON_NOT_SKIPPED,
       FILE_DATA_ENTRY_ECHO_SKIP_REASON_EXCLUDE_LIST,
       FILE_DATA_ENTRY_ECHO_SKIP_REASON_SOCKET_ERROR,
+      /* FILE_VERSION_1 and later only */
+      FILE_DATA_ENTRY_ECHO_SKIP_REASON_NOT_INCLUDED,
+      FILE_DATA_ENTRY_ECHO_SKIP_REASON_RESERVED,
       FILE_DATA_ENTRY_ECHO_SKIP_REASON_MAX,
     } file_data_entry_payload_echo_skip_reason_e;
     #define FILE_ECHO_SKIPPED_ERROR_CODE_MAX 0x000FFFFF
@@ -78,9 +94,11 @@ namespace sandor_laboratories
     typedef union __attribute__ ((packed))
     {
       /* Data recording successful echo reply */
-      file_data_entry_payload_echo_reply_s   echo_reply;
+      file_data_entry_payload_echo_reply_s    echo_reply;
+      /* Data recording successful echo reply with us resolution */
+      file_data_entry_payload_echo_reply_us_s echo_reply_us;
       /* Echo skipped for data entry */
-      file_data_entry_payload_echo_skipped_s echo_skipped;
+      file_data_entry_payload_echo_skipped_s  echo_skipped;
     } file_data_entry_payload_u;
 
     typedef struct __attribute__ ((packed))
@@ -91,6 +109,18 @@ namespace sandor_laboratories
       file_data_entry_payload_u payload;
     } file_data_entry_s;
 
+    /* Returns true if data entry records a successful echo reply of either resolution */
+    inline bool file_data_entry_is_reply(const file_data_entry_s *data_entry)
+    {
+      return ((FILE_DATA_ENTRY_ECHO_REPLY == data_entry->type) || (FILE_DATA_ENTRY_ECHO_REPLY_US == data_entry->type));
+    }
+    /* Echo reply time in ms of a data entry recording a successful echo reply */
+    inline reply_time_t file_data_entry_reply_time(const file_data_entry_s *data_entry)
+    {
+      return ((FILE_DATA_ENTRY_ECHO_REPLY_US == data_entry->type)?
+              (data_entry->payload.echo_reply_us.reply_time_us/1000):data_entry->payload.echo_reply.reply_time);
+    }
+
     typedef uint8_t file_checksum_t[FILE_CHECKSUM_SIZE];
 
     typedef struct __attribute__ ((packed))
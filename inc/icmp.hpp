@@ -1,11 +1,20 @@
 #ifndef __ICMP_HPP__
 #define __ICMP_HPP__
 
+#include <cassert>
+#include <cstring>
+
 #include "ipv4.hpp"
 
 #define ICMP_HEADER_SIZE_IPV4_WORDS 2
 #define ICMP_HEADER_SIZE_BYTES      (sizeof(ipv4_word_t)*ICMP_HEADER_SIZE_IPV4_WORDS)
 #define ICMP_PAYLOAD_OFFSET_WORDS   ICMP_HEADER_SIZE_IPV4_WORDS
+#define ICMP_PAYLOAD_OFFSET_BYTES   ICMP_HEADER_SIZE_BYTES
+
+/* Byte offsets of encoded ICMP header fields */
+#define ICMP_CHECKSUM_OFFSET_BYTES        2
+#define ICMP_IDENTIFIER_OFFSET_BYTES      4
+#define ICMP_SEQUENCE_NUMBER_OFFSET_BYTES 6
 
 typedef enum
 {
@@ -139,4 +148,78 @@ icmp_packet_meta_s parse_icmp_packet(const ipv4_payload_s*);
 
 size_t encode_icmp_packet(const icmp_packet_meta_s*, icmp_buffer_t *, size_t);
 
+/* Pre-encoded ICMP packet.  Packets are copied from the template and only the fields which change are patched */
+#define ICMP_PACKET_TEMPLATE_MAX_SIZE_BYTES 64
+typedef struct
+{
+  icmp_buffer_t buffer[ICMP_PACKET_TEMPLATE_MAX_SIZE_BYTES];
+  size_t        size;
+
+} icmp_packet_template_s;
+
+/* Encodes the ICMP packet into the template including checksum.  Returns false if the packet could not be encoded */
+bool init_icmp_packet_template(const icmp_packet_meta_s*, icmp_packet_template_s*);
+
+/* Copies the encoded template into buffer.  Returns size of the packet or 0 if the buffer is too small */
+inline size_t write_icmp_packet_template(const icmp_packet_template_s * packet_template, icmp_buffer_t * buffer, size_t buffer_size)
+{
+  size_t output_size = 0;
+
+  assert(packet_template != nullptr);
+  assert(buffer != nullptr);
+
+  if(packet_template->size <= buffer_size)
+  {
+    memcpy(buffer, packet_template->buffer, packet_template->size);
+    output_size = packet_template->size;
+  }
+
+  return output_size;
+}
+
+/* Overwrites size bytes at offset of an encoded ICMP packet and incrementally updates its checksum (RFC 1624, eqn. 3).
+    offset and size must be multiples of 16-bit words.  data is copied as is (network order). */
+inline void patch_icmp_packet(icmp_buffer_t * packet, const size_t offset, const void * data, const size_t size)
+{
+  const uint8_t *new_data = (const uint8_t*) data;
+  uint16_t       checksum;
+  uint_fast64_t  sum;
+  size_t         i = 0;
+
+  assert(packet != nullptr);
+  assert(data != nullptr);
+  assert(((offset % sizeof(uint16_t)) == 0) && ((size % sizeof(uint16_t)) == 0));
+  assert(offset > ICMP_CHECKSUM_OFFSET_BYTES);
+
+  memcpy(&checksum, &packet[ICMP_CHECKSUM_OFFSET_BYTES], sizeof(checksum));
+  sum = (uint16_t)~checksum;
+
+  /* 32-bit words are congruent to the sum of their 16-bit halves in ones' complement arithmetic */
+  for(; (i+sizeof(uint32_t)) <= size; i += sizeof(uint32_t))
+  {
+    uint32_t old_word, new_word;
+    memcpy(&old_word, &packet[offset+i], sizeof(old_word));
+    memcpy(&new_word, &new_data[i],      sizeof(new_word));
+    sum += (uint32_t)~old_word;
+    sum += new_word;
+  }
+  if(i < size)
+  {
+    uint16_t old_word, new_word;
+    memcpy(&old_word, &packet[offset+i], sizeof(old_word));
+    memcpy(&new_word, &new_data[i],      sizeof(new_word));
+    sum += (uint16_t)~old_word;
+    sum += new_word;
+  }
+
+  sum = (sum & 0xFFFFFFFF) + (sum >> 32);
+  sum = (sum & IPV4_HALF_WORD_MASK) + (sum>>IPV4_HALF_WORD_BITS);
+  sum = (sum & IPV4_HALF_WORD_MASK) + (sum>>IPV4_HALF_WORD_BITS);
+  sum = (sum & IPV4_HALF_WORD_MASK) + (sum>>IPV4_HALF_WORD_BITS);
+  checksum = (uint16_t)~sum;
+
+  memcpy(&packet[offset], data, size);
+  memcpy(&packet[ICMP_CHECKSUM_OFFSET_BYTES], &checksum, sizeof(checksum));
+}
+
 #endif /* __ICMP_HPP__ */
\ No newline at end of file
@@ -21,6 +21,7 @@ typedef unsigned int ipv4_word_size_t;
 
 #define IPV4_VERSION 4
 #define IPV4_HEADER_FIXED_SIZE_WORDS 5
+#define IPV4_HEADER_MAX_SIZE_WORDS   15
 typedef struct __attribute__((packed))
 {
   uint8_t  version:4;
@@ -89,4 +90,16 @@ ipv4_word_size_t get_ipv4_header_size(const ipv4_header_s*);
 
 size_t encode_ipv4_packet(const ipv4_packet_meta_s*, ipv4_word_t *, size_t);
 
+/* Incrementally updates a ones' complement checksum when a 16-bit word changes from old_word to new_word (RFC 1624, eqn. 3).
+    The ones' complement sum is byte order independent so all values may be in network order as long as they are consistent. */
+inline uint16_t update_ipv4_checksum(const uint16_t checksum, const uint16_t old_word, const uint16_t new_word)
+{
+  uint_fast32_t sum = ((uint16_t)~checksum) + ((uint16_t)~old_word) + new_word;
+
+  sum = (sum & IPV4_HALF_WORD_MASK) + (sum>>IPV4_HALF_WORD_BITS);
+  sum = (sum & IPV4_HALF_WORD_MASK) + (sum>>IPV4_HALF_WORD_BITS);
+
+  return (uint16_t)~sum;
+}
+
 #endif /* __IPV4_HPP__ */
\ No newline at end of file
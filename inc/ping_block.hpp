@@ -2,10 +2,20 @@
 #define __PING_BLOCK_HPP__
 
 #include <cstdint>
+#include <net/if.h>
 #include <pthread.h>
 #include <time.h>
 #include <vector>
 
+#include "address_set.hpp"
+#include "icmp.hpp"
+#include "prefix_scheduler.hpp"
+#include "probe_cookie.hpp"
+#include "rate_limiter.hpp"
+#include "scan_order.hpp"
+#include "send_engine.hpp"
+#include "timestamp.hpp"
+
 namespace sandor_laboratories
 {
   namespace pingo
@@ -14,27 +24,28 @@ namespace sandor_laboratories
     typedef uint32_t reply_time_t;
     #define PINGO_BLOCK_PING_TIME_NO_RESPONSE 0xFFFFFFFF
 
-    typedef struct
-    {
-      uint32_t ip;
-      uint32_t subnet_mask;
-
-    } ping_block_excluded_ip_s;
-    typedef std::vector<ping_block_excluded_ip_s> ping_block_excluded_ip_list_t;
-
     typedef enum
     {
       PING_BLOCK_IP_SKIP_REASON_NOT_SKIPPED,
       PING_BLOCK_IP_SKIP_REASON_EXCLUDE_LIST,
       PING_BLOCK_IP_SKIP_REASON_SOCKET_ERROR,
+      PING_BLOCK_IP_SKIP_REASON_NOT_INCLUDED,
+      PING_BLOCK_IP_SKIP_REASON_RESERVED,
       PING_BLOCK_IP_SKIP_REASON_MAX,
     } ping_block_skip_reason_e;
     
     typedef struct
     {
       bool                     reply_valid;
+      /* Pinged again by the retry pass after not replying */
+      bool                     retried;
       /* Ping time in ms, -1 for no response */
       reply_time_t             ping_time;
+      /* Ping time in us, -1 for no response */
+      uint32_t                 ping_time_us;
+      /* Time from building the echo request to the kernel transmitting it in us.  0 if no TX timestamp was read.
+          Ping times are measured from transmission once it is known */
+      uint32_t                 send_delay_us;
 
       ping_block_skip_reason_e skip_reason;
       int                      skip_errno;
@@ -47,21 +58,74 @@ namespace sandor_laboratories
       struct timespec ping_batch_cooldown;
       unsigned int    socket_ttl;
       uint16_t        identifier;
-      bool            fixed_sequence_number;
-      uint16_t        sequence_number;
+      /* Keys the probe cookie carried in the sequence number and payload of every echo request.  Receiver must use the same key */
+      probe_cookie_key_s cookie_key;
       unsigned int    send_attempts;
-      ping_block_excluded_ip_list_t *excluded_ip_list;
+      /* Initial backoff when the socket reports EAGAIN or ENOBUFS */
+      struct timespec send_backoff;
+      /* SO_SNDBUF in bytes for sockets opened with open_socket().  0 keeps the kernel default */
+      unsigned int    socket_send_buffer;
+      /* Compiled set of addresses which are never pinged.  May be shared between ping blocks */
+      const address_set_c *exclude_set;
+      /* Compiled set of the only addresses which are pinged.  nullptr to ping every address.  May be shared between ping blocks */
+      const address_set_c *include_set;
+      /* Skips the built-in reserved address space which never answers */
+      bool            skip_reserved;
+      /* Paces dispatch to a target rate instead of ping_batch_cooldown.  May be shared between ping blocks */
+      rate_limiter_c *rate_limiter;
+      /* Order addresses are visited in during dispatch.  Permuted order is derived from scan_seed and the block's range */
+      scan_order_e    scan_order;
+      uint_fast64_t   scan_seed;
+      /* Caps on the rate of pings into one /24 and one /16.  If either is set, pings are interleaved across prefixes in place of scan_order */
+      prefix_scheduler_config_s prefix_caps;
+      /* Socket type used to send echo requests.  Link layer backends send directly on send_interface to gateway_mac */
+      send_engine_backend_e send_backend;
+      char            send_interface[IF_NAMESIZE];
+      uint8_t         gateway_mac[ETHER_ADDR_LEN];
+      /* AF_XDP socket bound once to send_interface and shared by every sender and the receiver.  nullptr for other backends */
+      xdp_socket_c   *xdp_socket;
+      /* Measures ping times from kernel TX timestamps instead of when each echo request was built.  Not supported by link layer backends */
+      bool            tx_timestamps;
+      /* Called with TX timestamps read by this block's send engines for addresses outside it.  Engines sharing a socket drain one error queue,
+          so stamps of another live ping block, such as one in its retry pass, may be read here.  nullptr drops them */
+      send_engine_tx_timestamp_cb foreign_tx_timestamp_cb;
+      void                       *foreign_tx_timestamp_user_data_ptr;
+      /* Time after a ping block is fully dispatched until addresses which have not replied are pinged once more by dispatch_retry().
+          0 for no retry pass */
+      struct timespec retry_delay;
     } ping_block_config_s;
 
     typedef struct 
     {
       unsigned int valid_replies;
+      /* Valid replies from addresses pinged again by the retry pass */
+      unsigned int retried_replies;
       unsigned int skipped_pings;
       reply_time_t min_reply_time;
       reply_time_t mean_reply_time;
       reply_time_t max_reply_time;
     } ping_block_stats_s;
 
+    typedef struct
+    {
+      /* Echo requests handed to the socket */
+      unsigned int  pings_sent;
+      /* Sends repeated after EAGAIN or ENOBUFS */
+      unsigned int  send_retries;
+      /* Echo requests dropped after a send error */
+      unsigned int  send_drops;
+      /* Echo requests handed to the socket and dropped by the retry pass */
+      unsigned int  retry_pings_sent;
+      unsigned int  retry_send_drops;
+      /* Target send rate in pings per second.  0 if not rate limited */
+      uint_fast64_t target_rate;
+      /* Pings held back by the /24 and /16 caps, and time every remaining prefix was at its cap */
+      uint_fast64_t prefix_deferred_24;
+      uint_fast64_t prefix_deferred_16;
+      uint_fast64_t prefix_waits;
+      uint_fast64_t prefix_wait_ms;
+    } ping_block_dispatch_stats_s;
+
     class ping_block_c
     {
       private:
@@ -69,20 +133,49 @@ namespace sandor_laboratories
         const unsigned int         address_count;
         const ping_block_config_s  config;
         ping_block_entry_s        *entry;
-        ping_block_excluded_ip_list_t excluded_ip_list;
+        /* True if exclude_set has a range overlapping this block */
+        bool                       exclude_set_overlaps;
 
         pthread_cond_t             dispatch_done_cond = PTHREAD_COND_INITIALIZER;
         bool                       dispatch_started;
         bool                       fully_dispatched;
+        unsigned int               dispatch_shard_count;
+        unsigned int               shards_started;
+        /* Shard indices whose dispatch has started, sized to dispatch_shard_count */
+        std::vector<bool>          shard_started;
+        unsigned int               shards_done;
         struct timespec            dispatch_start_time;
         struct timespec            dispatch_done_time;
         struct timespec            dispatch_time;
+        ping_block_dispatch_stats_s dispatch_stats;
+        bool                       retry_started;
+        bool                       retry_done;
 
         pthread_mutex_t            mutex = PTHREAD_MUTEX_INITIALIZER;
         void                       lock();
         void                       unlock();
 
-        bool                       exclude_ip_address(const uint32_t);
+        /* Returns why address is skipped.  run_last is set to the last address of the run skipped for the same reason, capped to this block */
+        ping_block_skip_reason_e   skip_ip_address(const uint32_t, uint32_t *run_last);
+        void                       mark_skipped(uint32_t first_skipped, uint32_t last_skipped, ping_block_skip_reason_e);
+
+        inline uint_fast64_t       get_scan_seed() const {return (config.scan_seed ^ ((((uint_fast64_t)get_first_address()) << 32) | get_address_count()));};
+        inline bool                is_retry_enabled() const {return ((config.retry_delay.tv_sec > 0) || (config.retry_delay.tv_nsec > 0));};
+        inline bool                is_prefix_capped() const {return ((config.prefix_caps.max_rate_24 > 0) || (config.prefix_caps.max_rate_16 > 0));};
+
+        static void                dispatch_drop_cb(uint32_t dest_address, int error, void * user_data_ptr);
+        static void                dispatch_tx_timestamp_cb(uint32_t dest_address, const icmp_buffer_t *icmp_packet, size_t icmp_packet_size, 
+                                                            timestamp_ns_t tx_time, void * user_data_ptr);
+        /* Flushes the send engine, paced by the rate limiter if configured.  Returns the number of pings sent */
+        unsigned int               dispatch_flush(send_engine_c*, unsigned int shard, unsigned int *batch_index);
+        /* First offset of the prefix capped slice of shard, on a /24 boundary.  Slice shard_count ends at the address count */
+        uint_fast64_t              prefix_shard_offset(unsigned int shard, unsigned int shard_count) const;
+        /* Next offset from the prefix scheduler.  Queued pings are flushed before waiting for a capped prefix so they are not held back with it */
+        bool                       next_scheduled_offset(prefix_scheduler_c*, send_engine_c*, unsigned int shard, 
+                                                         unsigned int *batch_index, unsigned int *pings_sent, uint_fast64_t *offset);
+        void                       init_echo_request_template(icmp_packet_template_s*) const;
+        /* Encodes an echo request to dest_address at offset in this block into the send engine's next slot and queues it */
+        void                       queue_echo_request(send_engine_c*, const icmp_packet_template_s*, uint32_t dest_address, uint_fast64_t offset) const;
 
       public:
         static void init_config(ping_block_config_s*);
@@ -94,15 +187,40 @@ namespace sandor_laboratories
         inline uint32_t get_first_address() const {return first_address;};
         inline uint32_t get_address_count() const {return address_count;};
         inline uint32_t get_last_address()  const {return (get_first_address()+get_address_count());};
+        /* Memory held by a ping block of address_count addresses */
+        static inline size_t get_memory_size(unsigned int address_count) {return (sizeof(ping_block_c)+(address_count*sizeof(ping_block_entry_s)));};
+        inline size_t   get_memory_size()   const {return get_memory_size(get_address_count());};
 
         /* Copies ping block entry for given address to ret_entry.  Returns false if error */
         bool get_ping_block_entry(uint32_t address, ping_block_entry_s* ret_entry);
 
-        /* Logs ping time.  Assumes ping reply is valid if called, but time may will be capped at PINGO_BLOCK_PING_TIME_NO_RESPONSE */
-        bool log_ping_time(uint32_t address, reply_time_t);
+        /* Logs ping time in us from when the echo request was built.  Assumes ping reply is valid if called, but time may will be capped at PINGO_BLOCK_PING_TIME_NO_RESPONSE.
+            Send delay is taken off once the request's TX timestamp is known, whether it is read before or after the reply */
+        bool log_ping_time(uint32_t address, uint32_t reply_delay_us);
+        /* Takes the send delay of the echo request to dest_address off its ping time from the request's TX timestamp.
+            Returns false if dest_address is not in this block */
+        bool log_tx_timestamp(uint32_t dest_address, const icmp_buffer_t *icmp_packet, size_t icmp_packet_size, timestamp_ns_t tx_time);
+
+        /* Opens a socket for the configured send backend for dispatching ping blocks.  Returns -1 on failure */
+        static int open_socket(const ping_block_config_s*);
+        /* Send engine configuration matching a ping block configuration.  Engines built from it may dispatch any ping block with the same configuration */
+        static void init_send_engine_config(const ping_block_config_s*, send_engine_config_s*);
 
-        /* Opens a IPv4 socket and dispatches ping echo requests for all IP address in this block */
+        /* Opens a IPv4 socket and dispatches ping echo requests for all IP address in this block.  Pings are sent in batches of ping_batch_size per syscall */
         bool dispatch();
+        /* Dispatches ping echo requests for one of shard_count contiguous slices of this block's scan order on the given socket.
+            Each shard must be dispatched exactly once, the block is fully dispatched when the last shard finishes */
+        bool dispatch_shard(int sockfd, unsigned int shard, unsigned int shard_count);
+        /* Same as above, sending on a long-lived send engine so its socket and buffers are reused across ping blocks.  Engine must be empty */
+        bool dispatch_shard(send_engine_c *send_engine, unsigned int shard, unsigned int shard_count);
+
+        /* Pings addresses of a fully dispatched ping block which have not replied once more, in the same scan order.
+            Pinged addresses are marked retried, a reply to either echo request counts.  Runs once per ping block on an empty send engine */
+        bool dispatch_retry(send_engine_c *send_engine);
+        /* Returns true if the retry pass has started */
+        bool            is_retry_started();
+        /* Blocks until the retry pass is done.  Returns immediately if retries are not configured */
+        void            wait_retry_done();
 
         /* Returns true if ping block has started dispatching */
         bool            is_dispatch_started();
@@ -118,6 +236,8 @@ namespace sandor_laboratories
         struct timespec time_since_dispatch();
         /* Blocks until dispatching is done */
         void            wait_dispatch_done();
+        /* Returns send statistics of the dispatch */
+        ping_block_dispatch_stats_s get_dispatch_stats();
 
         /* Returns stats from ping block data */
         ping_block_stats_s get_stats();
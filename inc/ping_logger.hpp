@@ -1,6 +1,8 @@
 #ifndef __PING_LOGGER_HPP__
 #define __PING_LOGGER_HPP__
 
+#include <cstddef>
+#include <cstdint>
 #include <deque>
 #include <pthread.h>
 
@@ -27,7 +29,8 @@ namespace sandor_laboratories
     typedef struct
     {
       struct timespec reply_delay;
-      pingo_payload_t payload;
+      /* Address the validated echo reply came from */
+      uint32_t        dest_address;
     } ping_logger_entry_echo_reply_s;
 
     typedef union
@@ -44,6 +47,28 @@ namespace sandor_laboratories
     typedef std::deque<ping_log_entry_s> log_queue_t;
     typedef std::deque<ping_block_c*>    ping_block_queue_t;
 
+    /* Default bound on the memory of ping blocks held while they dispatch and soak */
+    #define PING_LOGGER_DEFAULT_WINDOW_BYTES (1024UL*1024UL*1024UL)
+
+    /* Bounds the ping blocks held by the logger from push until they are popped.  0 leaves a bound unlimited */
+    typedef struct
+    {
+      unsigned int max_ping_blocks;
+      size_t       max_bytes;
+    } ping_block_window_s;
+
+    typedef struct
+    {
+      /* Ping blocks held and their memory */
+      unsigned int  ping_blocks;
+      size_t        bytes;
+      unsigned int  peak_ping_blocks;
+      size_t        peak_bytes;
+      /* Times the pusher waited for the window to drain and the total time waited */
+      uint_fast64_t full_waits;
+      uint_fast64_t full_wait_ms;
+    } ping_block_window_stats_s;
+
     class ping_logger_c
     {
       private:
@@ -61,6 +86,13 @@ namespace sandor_laboratories
         pthread_mutex_t    ping_block_mutex      = PTHREAD_MUTEX_INITIALIZER;
         pthread_cond_t     ping_block_ready_cond = PTHREAD_COND_INITIALIZER;
         ping_block_queue_t ping_block_queue;
+
+        /* Signalled as popped ping blocks leave room in the window */
+        pthread_cond_t     ping_block_window_cond = PTHREAD_COND_INITIALIZER;
+        ping_block_window_s       ping_block_window       = {.max_ping_blocks = 0, .max_bytes = 0};
+        ping_block_window_stats_s ping_block_window_stats = {};
+
+        bool ping_block_window_fits(size_t bytes) const;
         
         void lock_ping_block();
         void unlock_ping_block();
@@ -68,12 +100,22 @@ namespace sandor_laboratories
       public:
         /* Pushes a log entry into the log database */
         bool             push_log_entry(ping_log_entry_s);
+        /* Pushes count log entries with one lock of the database */
+        bool             push_log_entries(const ping_log_entry_s *, size_t count);
         /* Blocks until log entry is added to the logger database */
         void             wait_for_log_entry();
         /* Process the next log entry in the queue */
         void             process_log_entry();
 
-        /* Pushes a ping block into the logger database.  Pusher's is responsible to init and dispatch pushed ping block */
+        /* Sets the bounds of the ping block window.  Ping blocks already held are kept */
+        void          set_ping_block_window(const ping_block_window_s*);
+        /* Blocks until a ping block of the given memory size fits in the window, then holds its place until it is pushed and popped.
+            A ping block always fits an empty window.  Call before allocating the ping block so the window bounds memory in use,
+            every pushed ping block must have been waited for */
+        void          wait_for_ping_block_window(size_t bytes);
+        ping_block_window_stats_s get_ping_block_window_stats();
+
+        /* Pushes a ping block into the logger database, taking over its place in the window.  Pusher's is responsible to init and dispatch pushed ping block */
         bool          push_ping_block(ping_block_c*);
         /* Returns a pointer to the oldest ping block in the logger database without popping.  Popper should NOT delete peeked ping block.
             Returns null if no ping blocks are in the logger database. */
@@ -83,8 +125,17 @@ namespace sandor_laboratories
         ping_block_c* pop_ping_block();
         /* Blocks until ping block is added to the logger database */
         void          wait_for_ping_block();
+        /* Blocks until the logger database holds a ping block whose retry pass has not started and returns the oldest.
+            Popper must wait for the retry pass to finish before deleting the ping block */
+        ping_block_c* wait_for_ping_block_retry();
         /* Returns the number or registered ping blocks */
         unsigned int  get_num_ping_blocks();
+
+        /* Logs a TX timestamp to whichever registered ping block holds dest_address.  Returns false if none does */
+        bool          log_tx_timestamp(uint32_t dest_address, const icmp_buffer_t *icmp_packet, size_t icmp_packet_size, timestamp_ns_t tx_time);
+        /* send_engine_tx_timestamp_cb forwarding to log_tx_timestamp(), user_data_ptr is the ping logger */
+        static void   log_tx_timestamp_cb(uint32_t dest_address, const icmp_buffer_t *icmp_packet, size_t icmp_packet_size, 
+                                          timestamp_ns_t tx_time, void * user_data_ptr);
     };
   }
 }
@@ -3,6 +3,7 @@
 
 #include <cstdint>
 #include <cstdlib>
+#include <ctime>
 #include <linux/limits.h>
 
 namespace sandor_laboratories
@@ -10,6 +11,8 @@ namespace sandor_laboratories
   namespace pingo
   {
     #define ICMP_IDENTIFIER 0xEDED
+    /* Shards offset the 16-bit ICMP identifier, more would give two shards the same one */
+    #define PINGO_SHARD_COUNT_MAX 65536U
 
     #define UNUSED(x) (void)(x)
 
@@ -24,6 +27,19 @@ namespace sandor_laboratories
     #define BITS_1   1
 
     #define MAX_IP 0xFFFFFFFF
+    /* Addresses per ping block if not given with -s */
+    #define PINGO_DEFAULT_PING_BLOCK_SIZE 65536
+    /* Ping blocks built ahead of dispatch if not given with --prepare-blocks */
+    #define PINGO_DEFAULT_PREPARE_BLOCKS  1
+    /* Bounds of ping blocks sized by --block-duration.  Sizes are whole /24s */
+    #define PINGO_ADAPTIVE_PING_BLOCK_SIZE_MIN     256
+    #define PINGO_ADAPTIVE_PING_BLOCK_SIZE_MAX 1048576
+    /* Most a ping block sized by --block-duration grows over the last, so a block dispatched faster than the clock resolves does not jump to the maximum */
+    #define PINGO_ADAPTIVE_PING_BLOCK_GROWTH_MAX     4
+    /* Seconds a ping block soaks for replies after dispatch if not given with -t */
+    #define PINGO_DEFAULT_SOAK_TIMEOUT    60
+    /* Seconds between reports of invalid packets received */
+    #define PINGO_INVALID_PACKET_REPORT_INTERVAL 10U
     #define IP_BYTE_A_OFFSET 24
     #define IP_BYTE_B_OFFSET 16
     #define IP_BYTE_C_OFFSET  8
@@ -35,12 +51,19 @@ namespace sandor_laboratories
     #define FILE_NAME_MAX_LENGTH NAME_MAX
     #define FILE_PATH_MAX_LENGTH PATH_MAX
 
-    typedef struct 
+    /* Echo request payload.  Replies are validated statelessly by recomputing the probe cookie of the replying address,
+        the low 16 bits of the cookie are carried in the ICMP sequence number */
+    typedef struct __attribute__((packed))
     {
-      uint32_t        dest_address;
-      struct timespec request_time;
+      /* get_timestamp_us32() when the request was built.  Wraps every ~71 minutes */
+      uint32_t        request_time;
+      /* High 32 bits of the probe cookie */
+      uint32_t        cookie;
     } pingo_payload_t;
 
+    /* Replies to requests older than this are rejected as stale.  Half the request_time wrap so age is never ambiguous */
+    #define PINGO_PAYLOAD_MAX_AGE_US 0x7FFFFFFFUL
+
     /* Time Utils */
     /* ms*1000us/ms*1000ns/us */
     #define MS_TO_NANOSEC(ms) (ms*1000UL*1000UL)
@@ -49,6 +72,8 @@ namespace sandor_laboratories
     #define NANOSEC_TO_MS(ns) (ns/(1000UL*1000UL))
     #define TIMESPEC_TO_MS(timespec_in) ( SECONDS_TO_MS(timespec_in.tv_sec) + \
                                           NANOSEC_TO_MS(timespec_in.tv_nsec) )
+    #define TIMESPEC_TO_US(timespec_in) ( (timespec_in.tv_sec*1000UL*1000UL) + (timespec_in.tv_nsec/1000UL) )
+    #define US_TO_TIMESPEC(us, timespec_out) { timespec_out.tv_sec = (us/(1000UL*1000UL)); timespec_out.tv_nsec = ((us % (1000UL*1000UL))*1000UL); }
     #define MS_TO_TIMESPEC(ms, timespec_out) { timespec_out.tv_sec = MS_TO_SECONDS(ms); timespec_out.tv_nsec = (MS_TO_NANOSEC(ms) % (1000UL*1000UL*1000UL)); }
 
     /* a-b=diff, returns false if input is null or b > a */
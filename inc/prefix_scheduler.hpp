@@ -0,0 +1,96 @@
+#ifndef __PREFIX_SCHEDULER_HPP__
+#define __PREFIX_SCHEDULER_HPP__
+
+#include <cstdint>
+#include <vector>
+
+#include "timestamp.hpp"
+
+namespace sandor_laboratories
+{
+  namespace pingo
+  {
+    #define PREFIX_SCHEDULER_SLASH_24_SHIFT 8
+    #define PREFIX_SCHEDULER_SLASH_16_SHIFT 16
+
+    typedef struct
+    {
+      /* Most pings per second sent into one /24 and into one /16.  0 for no cap */
+      unsigned int max_rate_24;
+      unsigned int max_rate_16;
+    } prefix_scheduler_config_s;
+
+    typedef struct
+    {
+      /* Pings held back at least once because their /24 or /16 was at its cap */
+      uint_fast64_t deferred_24;
+      uint_fast64_t deferred_16;
+      /* Times every remaining prefix was at its cap, and nanoseconds spent waiting for one to open */
+      uint_fast64_t waits;
+      uint_fast64_t wait_ns;
+    } prefix_scheduler_stats_s;
+
+    typedef enum
+    {
+      PREFIX_SCHEDULER_READY,
+      /* Every remaining prefix is at its cap until ready_time */
+      PREFIX_SCHEDULER_WAIT,
+      PREFIX_SCHEDULER_DONE,
+    } prefix_scheduler_next_e;
+
+    /* Orders the offsets of a ping block so consecutive pings go to different prefixes, and holds back pings into a prefix at its cap.
+        Offsets are grouped by /24 and visited round robin, with the /24s of different /16s interleaved.  Within a /24 offsets go in order.
+        Caps space pings into a prefix at least 1/max_rate apart.  Not thread safe, every shard schedules its own offsets. */
+    class prefix_scheduler_c
+    {
+      private:
+        typedef struct
+        {
+          /* Next and end offset of the /24 in the ping block */
+          uint_fast64_t  offset;
+          uint_fast64_t  end_offset;
+          unsigned int   slash_16;
+          /* Round robin ring of /24s with offsets left */
+          unsigned int   next;
+          unsigned int   previous;
+          /* Ping at offset has been counted as deferred */
+          bool           deferred;
+          timestamp_ns_t ready_time;
+        } slash_24_s;
+
+        const uint32_t             first_address;
+        /* Spacing of pings into one prefix from its cap.  0 for no cap */
+        const timestamp_ns_t       interval_24;
+        const timestamp_ns_t       interval_16;
+
+        std::vector<slash_24_s>    slash_24;
+        std::vector<timestamp_ns_t> slash_16_ready_time;
+        uint32_t                   first_slash_24;
+        uint32_t                   first_slash_16;
+        unsigned int               active;
+        unsigned int               current;
+        /* Time of the last next(), charged to the prefixes of the ping sent */
+        timestamp_ns_t             now;
+
+        prefix_scheduler_stats_s   stats;
+
+        void                       remove(unsigned int index);
+
+      public:
+        /* Schedules offsets first_offset..end_offset-1 of a ping block starting at first_address */
+        prefix_scheduler_c(uint32_t first_address, uint_fast64_t first_offset, uint_fast64_t end_offset, const prefix_scheduler_config_s *);
+
+        /* Returns READY with the next offset whose /24 and /16 are under their caps, WAIT with the time the first prefix opens,
+            or DONE once every offset has been returned.  Offsets are returned once whether or not a ping is sent */
+        prefix_scheduler_next_e    next(uint_fast64_t *offset, timestamp_ns_t *ready_time);
+        /* Charges a ping sent to offset against the caps of its prefixes */
+        void                       sent(uint_fast64_t offset);
+        /* Adds a wait for ready_time to the stats */
+        void                       waited(timestamp_ns_t wait_ns);
+
+        inline prefix_scheduler_stats_s get_stats() const {return stats;};
+    };
+  }
+}
+
+#endif /* __PREFIX_SCHEDULER_HPP__ */
@@ -0,0 +1,64 @@
+#ifndef __PROBE_COOKIE_HPP__
+#define __PROBE_COOKIE_HPP__
+
+#include <cstdint>
+
+namespace sandor_laboratories
+{
+  namespace pingo
+  {
+    typedef uint64_t probe_cookie_t;
+
+    /* SipHash key shared by the senders and receiver of one run */
+    typedef struct
+    {
+      uint64_t k0;
+      uint64_t k1;
+    } probe_cookie_key_s;
+
+    /* Fills key from the kernel random source.  Returns false if no randomness was available */
+    bool init_probe_cookie_key(probe_cookie_key_s*);
+
+    #define PROBE_COOKIE_ROTL(x, b) (uint64_t)(((x) << (b)) | ((x) >> (64 - (b))))
+    #define PROBE_COOKIE_SIPROUND(v0, v1, v2, v3) \
+      { \
+        v0 += v1; v1 = PROBE_COOKIE_ROTL(v1, 13); v1 ^= v0; v0 = PROBE_COOKIE_ROTL(v0, 32); \
+        v2 += v3; v3 = PROBE_COOKIE_ROTL(v3, 16); v3 ^= v2; \
+        v0 += v3; v3 = PROBE_COOKIE_ROTL(v3, 21); v3 ^= v0; \
+        v2 += v1; v1 = PROBE_COOKIE_ROTL(v1, 17); v1 ^= v2; v2 = PROBE_COOKIE_ROTL(v2, 32); \
+      }
+
+    /* Keyed cookie of a probe to dest_address sent at request_time.  SipHash-2-4 of the 8 byte message (dest_address << 32 | request_time),
+        so replies can be validated from their own contents without keeping per-probe state */
+    inline probe_cookie_t probe_cookie(const probe_cookie_key_s * key, uint32_t dest_address, uint32_t request_time)
+    {
+      const uint64_t message = ((((uint64_t)dest_address) << 32) | request_time);
+      /* Final block holds only the message length */
+      const uint64_t length_block = (((uint64_t)sizeof(message)) << 56);
+      uint64_t v0 = key->k0 ^ 0x736f6d6570736575ULL;
+      uint64_t v1 = key->k1 ^ 0x646f72616e646f6dULL;
+      uint64_t v2 = key->k0 ^ 0x6c7967656e657261ULL;
+      uint64_t v3 = key->k1 ^ 0x7465646279746573ULL;
+
+      v3 ^= message;
+      PROBE_COOKIE_SIPROUND(v0, v1, v2, v3);
+      PROBE_COOKIE_SIPROUND(v0, v1, v2, v3);
+      v0 ^= message;
+
+      v3 ^= length_block;
+      PROBE_COOKIE_SIPROUND(v0, v1, v2, v3);
+      PROBE_COOKIE_SIPROUND(v0, v1, v2, v3);
+      v0 ^= length_block;
+
+      v2 ^= 0xff;
+      PROBE_COOKIE_SIPROUND(v0, v1, v2, v3);
+      PROBE_COOKIE_SIPROUND(v0, v1, v2, v3);
+      PROBE_COOKIE_SIPROUND(v0, v1, v2, v3);
+      PROBE_COOKIE_SIPROUND(v0, v1, v2, v3);
+
+      return (v0 ^ v1 ^ v2 ^ v3);
+    }
+  }
+}
+
+#endif /* __PROBE_COOKIE_HPP__ */
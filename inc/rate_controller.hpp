@@ -0,0 +1,77 @@
+#ifndef __RATE_CONTROLLER_HPP__
+#define __RATE_CONTROLLER_HPP__
+
+#include <cstdint>
+#include <pthread.h>
+
+namespace sandor_laboratories
+{
+  namespace pingo
+  {
+    /* Default min_rate as a share of max_rate */
+    #define RATE_CONTROLLER_DEFAULT_MIN_RATE_DIVISOR 16
+
+    typedef struct
+    {
+      /* Bounds of the adapted rate in pings per second */
+      uint_fast64_t min_rate;
+      uint_fast64_t max_rate;
+      /* Rate added after a ping block dispatched without congestion */
+      uint_fast64_t increase;
+      /* Rate is multiplied by decrease_percent/100 on congestion */
+      unsigned int  decrease_percent;
+      /* Congestion if send retries and drops exceed this share of pings sent, in percent */
+      unsigned int  send_error_percent;
+      /* Congestion if a ping block's reply yield falls below this share of the running average yield, in percent */
+      unsigned int  yield_drop_percent;
+    } rate_controller_config_s;
+
+    typedef enum
+    {
+      RATE_CONTROLLER_ACTION_HOLD,
+      RATE_CONTROLLER_ACTION_INCREASE,
+      RATE_CONTROLLER_ACTION_DECREASE_SEND_ERRORS,
+      RATE_CONTROLLER_ACTION_DECREASE_YIELD,
+      RATE_CONTROLLER_ACTION_MAX,
+    } rate_controller_action_e;
+
+    /* Additive-increase/multiplicative-decrease controller of the send rate.
+        Send errors are reported as each ping block finishes dispatching, reply yield once it has soaked.
+        Send errors show local congestion (socket or device queue full), falling yield shows probes lost upstream.
+        Sender applies get_rate() to its rate limiter between ping blocks.  Thread safe. */
+    class rate_controller_c
+    {
+      private:
+        pthread_mutex_t          mutex = PTHREAD_MUTEX_INITIALIZER;
+        void                     lock();
+        void                     unlock();
+
+        const rate_controller_config_s config;
+        /* Current rate in pings per second */
+        uint_fast64_t            rate;
+
+        /* Running average of reply yield in parts per million of pinged addresses.  0 until the first sample */
+        uint_fast64_t            average_yield_ppm;
+
+        uint_fast64_t            clamp(uint_fast64_t clamp_rate) const;
+
+      public:
+        static void init_config(rate_controller_config_s*, uint_fast64_t min_rate, uint_fast64_t max_rate);
+
+        rate_controller_c(uint_fast64_t initial_rate, const rate_controller_config_s *);
+        ~rate_controller_c();
+
+        /* Feeds back the send result of a dispatched ping block.  Returns action taken */
+        rate_controller_action_e dispatch_feedback(unsigned int pings_sent, unsigned int send_retries, unsigned int send_drops);
+        /* Feeds back the replies of a soaked ping block.  Returns action taken */
+        rate_controller_action_e yield_feedback(unsigned int pinged_addresses, unsigned int valid_replies);
+
+        /* Returns the current rate in pings per second */
+        uint_fast64_t            get_rate();
+
+        static const char *      action_string(rate_controller_action_e);
+    };
+  }
+}
+
+#endif /* __RATE_CONTROLLER_HPP__ */
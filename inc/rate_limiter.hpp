@@ -0,0 +1,51 @@
+#ifndef __RATE_LIMITER_HPP__
+#define __RATE_LIMITER_HPP__
+
+#include <cstdint>
+#include <pthread.h>
+#include <time.h>
+
+namespace sandor_laboratories
+{
+  namespace pingo
+  {
+    typedef uint_fast64_t rate_limiter_ns_t;
+
+    #define RATE_LIMITER_NS_PER_SECOND 1000000000UL
+
+    /* Token bucket pacing packets to a target rate.  Tokens are reserved against absolute deadlines on CLOCK_MONOTONIC
+        so sleep overshoot and time spent sending are absorbed instead of accumulating as drift.  Thread safe. */
+    class rate_limiter_c
+    {
+      private:
+        pthread_mutex_t    mutex = PTHREAD_MUTEX_INITIALIZER;
+        void               lock();
+        void               unlock();
+
+        /* Target rate in packets per second */
+        uint_fast64_t      rate;
+        /* Maximum number of tokens which may accumulate while idle */
+        unsigned int       burst;
+        /* Deadline at which the next token is available */
+        rate_limiter_ns_t  next_token_time;
+        /* Sub-nanosecond remainder of token time, in units of 1/rate ns */
+        uint_fast64_t      next_token_remainder;
+
+        static rate_limiter_ns_t get_time_ns();
+
+      public:
+        rate_limiter_c(uint_fast64_t rate, unsigned int burst);
+        ~rate_limiter_c();
+
+        /* Blocks until count tokens are available */
+        void          acquire(unsigned int count);
+
+        /* Returns the target rate in packets per second */
+        uint_fast64_t get_rate();
+        /* Changes the target rate.  Tokens already reserved keep their deadlines */
+        void          set_rate(uint_fast64_t rate);
+    };
+  }
+}
+
+#endif /* __RATE_LIMITER_HPP__ */
\ No newline at end of file
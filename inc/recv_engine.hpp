@@ -0,0 +1,93 @@
+#ifndef __RECV_ENGINE_HPP__
+#define __RECV_ENGINE_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <vector>
+
+#include "ipv4.hpp"
+#include "timestamp.hpp"
+#include "xdp_socket.hpp"
+
+namespace sandor_laboratories
+{
+  namespace pingo
+  {
+    /* Size of each packet slot in the receive batch.  Far larger than any echo reply of interest, longer packets are truncated */
+    #define RECV_ENGINE_SLOT_SIZE_BYTES   2048
+    #define RECV_ENGINE_SLOT_SIZE_WORDS   BYTE_SIZE_TO_IPV4_WORD_SIZE(RECV_ENGINE_SLOT_SIZE_BYTES)
+    /* Packets read per recvmmsg() call if not configured */
+    #define RECV_ENGINE_DEFAULT_BATCH_SIZE 64
+    /* Room for the receive timestamp control message of one packet */
+    #define RECV_ENGINE_CONTROL_SIZE_BYTES CMSG_SPACE(sizeof(struct timespec))
+
+    typedef struct
+    {
+      /* Most packets read per batch */
+      unsigned int  batch_size;
+      /* AF_XDP socket replies are read from in place of sockfd.  nullptr for other backends */
+      xdp_socket_c *xdp_socket;
+      /* Longest wait for the first packet of a batch, AF_XDP only.  Socket backends wait for SO_RCVTIMEO */
+      int           timeout_ms;
+    } recv_engine_config_s;
+
+    /* One packet of the last batch.  buffer is only valid until the next receive() */
+    typedef struct
+    {
+      const ipv4_word_t  *buffer;
+      size_t              size;
+      const struct sockaddr_in *src_addr;
+      socklen_t           addrlen;
+      /* Kernel receive timestamp in the get_timestamp_ns() timebase.  0 if the socket did not stamp the packet */
+      timestamp_ns_t      rx_time;
+    } recv_engine_packet_s;
+
+    typedef struct
+    {
+      /* Calls which returned at least one packet, and the packets they returned */
+      uint_fast64_t batches;
+      uint_fast64_t packets;
+      /* Packets the caller found invalid, such as those truncated to their slot */
+      uint_fast64_t invalid_packets;
+    } recv_engine_stats_s;
+
+    /* Reads packets a batch at a time into fixed slots, one recvmmsg() call per batch.
+        Slots are not cleared between batches, only the bytes received into a slot are valid */
+    class recv_engine_c
+    {
+      private:
+        const int                        sockfd;
+        const recv_engine_config_s       config;
+        recv_engine_stats_s              stats;
+
+        std::vector<struct mmsghdr>      msg;
+        std::vector<struct iovec>        iov;
+        std::vector<struct sockaddr_in>  src_addr;
+        std::vector<ipv4_word_t>         buffer;
+        std::vector<uint8_t>             control;
+        unsigned int                     received;
+
+        int                              receive_xdp();
+
+      public:
+        static void init_config(recv_engine_config_s*);
+
+        recv_engine_c(int sockfd, const recv_engine_config_s*);
+
+        inline recv_engine_stats_s get_stats() const {return stats;};
+        /* Counts a packet of the last batch the caller could not parse */
+        inline void            count_invalid_packet() {stats.invalid_packets++;};
+
+        /* Waits for packets and reads as many as are waiting, up to the batch size.
+            Returns the number of packets read, or -1 with errno set.  EWOULDBLOCK if none arrived before the timeout */
+        int                    receive();
+        /* Packet i of the last batch */
+        recv_engine_packet_s   get_packet(unsigned int i) const;
+    };
+  }
+}
+
+#endif /* __RECV_ENGINE_HPP__ */
@@ -0,0 +1,82 @@
+#ifndef __RESERVED_ADDRESS_HPP__
+#define __RESERVED_ADDRESS_HPP__
+
+#include <cstddef>
+#include <cstdint>
+
+#include "address_set.hpp"
+
+namespace sandor_laboratories
+{
+  namespace pingo
+  {
+    #define RESERVED_ADDRESS_RANGE(a, b, c, d, prefix_length) \
+      { .first = (((uint32_t)(a) << 24) | ((uint32_t)(b) << 16) | ((uint32_t)(c) << 8) | (uint32_t)(d)), \
+        .last  = (((uint32_t)(a) << 24) | ((uint32_t)(b) << 16) | ((uint32_t)(c) << 8) | (uint32_t)(d)) | (uint32_t)(0xFFFFFFFFULL >> (prefix_length)) }
+
+    /* IANA IPv4 special-purpose address space which never answers from the public internet (RFC 6890 and updates).
+        Sorted and disjoint so lookups can binary search */
+    constexpr address_range_s reserved_address_ranges[] =
+    {
+      RESERVED_ADDRESS_RANGE(  0,   0,   0, 0,  8), /* "This network" */
+      RESERVED_ADDRESS_RANGE( 10,   0,   0, 0,  8), /* Private use */
+      RESERVED_ADDRESS_RANGE(100,  64,   0, 0, 10), /* Shared address space */
+      RESERVED_ADDRESS_RANGE(127,   0,   0, 0,  8), /* Loopback */
+      RESERVED_ADDRESS_RANGE(169, 254,   0, 0, 16), /* Link local */
+      RESERVED_ADDRESS_RANGE(172,  16,   0, 0, 12), /* Private use */
+      RESERVED_ADDRESS_RANGE(192,   0,   0, 0, 24), /* IETF protocol assignments */
+      RESERVED_ADDRESS_RANGE(192,   0,   2, 0, 24), /* Documentation (TEST-NET-1) */
+      RESERVED_ADDRESS_RANGE(192, 168,   0, 0, 16), /* Private use */
+      RESERVED_ADDRESS_RANGE(198,  18,   0, 0, 15), /* Benchmarking */
+      RESERVED_ADDRESS_RANGE(198,  51, 100, 0, 24), /* Documentation (TEST-NET-2) */
+      RESERVED_ADDRESS_RANGE(203,   0, 113, 0, 24), /* Documentation (TEST-NET-3) */
+      RESERVED_ADDRESS_RANGE(224,   0,   0, 0,  4), /* Multicast */
+      RESERVED_ADDRESS_RANGE(240,   0,   0, 0,  4), /* Reserved for future use and limited broadcast */
+    };
+    constexpr size_t reserved_address_range_count = (sizeof(reserved_address_ranges)/sizeof(reserved_address_ranges[0]));
+
+    constexpr bool reserved_address_ranges_sorted()
+    {
+      bool ret_val = true;
+
+      for(size_t i = 1; i < reserved_address_range_count; i++)
+      {
+        ret_val = ret_val && (reserved_address_ranges[i-1].last < reserved_address_ranges[i].first);
+      }
+
+      return ret_val;
+    }
+    static_assert(reserved_address_ranges_sorted(), "Reserved address ranges must be sorted and disjoint");
+
+    /* Returns true if address is reserved.  range_last is set to the last address of the reserved range containing it */
+    inline bool reserved_address(uint32_t address, uint32_t *range_last)
+    {
+      size_t low  = 0;
+      size_t high = reserved_address_range_count;
+
+      /* Find the first range ending at or after address */
+      while(low < high)
+      {
+        const size_t middle = (low + ((high-low)/2));
+        if(reserved_address_ranges[middle].last < address)
+        {
+          low = (middle+1);
+        }
+        else
+        {
+          high = middle;
+        }
+      }
+
+      const bool ret_val = ((low < reserved_address_range_count) && (reserved_address_ranges[low].first <= address));
+      if(ret_val && (range_last != nullptr))
+      {
+        *range_last = reserved_address_ranges[low].last;
+      }
+
+      return ret_val;
+    }
+  }
+}
+
+#endif /* __RESERVED_ADDRESS_HPP__ */
@@ -0,0 +1,56 @@
+#ifndef __SCAN_ORDER_HPP__
+#define __SCAN_ORDER_HPP__
+
+#include <cstdint>
+
+namespace sandor_laboratories
+{
+  namespace pingo
+  {
+    typedef uint_fast64_t scan_order_position_t;
+
+    typedef enum
+    {
+      SCAN_ORDER_SEQUENTIAL,
+      SCAN_ORDER_PERMUTED,
+      SCAN_ORDER_MAX,
+    } scan_order_e;
+
+    /* Order to visit the offsets 0..count-1 of an address range.
+        Permuted order walks the multiplicative cyclic group of integers modulo the smallest prime p > count.
+        Generator and starting element are derived from a seed so the order is deterministic and any position
+        can be resumed directly with modular exponentiation.  Group elements >= count are skipped. */
+    class scan_order_c
+    {
+      private:
+        const scan_order_e    order;
+        const uint_fast64_t   count;
+        uint_fast64_t         prime;
+        uint_fast64_t         generator;
+        uint_fast64_t         first_element;
+
+        /* Current group element and position in the group.  Positions range 0..prime-2 */
+        uint_fast64_t         element;
+        scan_order_position_t position;
+
+        static uint_fast64_t mul_mod(uint_fast64_t a, uint_fast64_t b, uint_fast64_t modulus);
+        static uint_fast64_t pow_mod(uint_fast64_t base, uint_fast64_t exponent, uint_fast64_t modulus);
+        static bool          is_prime(uint_fast64_t n);
+        static bool          is_generator(uint_fast64_t g, uint_fast64_t p);
+
+      public:
+        scan_order_c(scan_order_e order, uint_fast64_t count, uint_fast64_t seed = 0);
+
+        /* Number of positions in the order.  Positions not mapping to an offset are skipped by next() */
+        scan_order_position_t get_positions() const;
+
+        /* Moves to position.  next() returns the first offset at or after position */
+        void seek(scan_order_position_t position);
+
+        /* Returns the next offset before end_position.  Returns false once end_position is reached */
+        bool next(uint_fast64_t * offset, scan_order_position_t end_position);
+    };
+  }
+}
+
+#endif /* __SCAN_ORDER_HPP__ */
\ No newline at end of file
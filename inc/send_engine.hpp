@@ -0,0 +1,184 @@
+#ifndef __SEND_ENGINE_HPP__
+#define __SEND_ENGINE_HPP__
+
+#include <cstdint>
+#include <ctime>
+#include <linux/if_packet.h>
+#include <net/ethernet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <vector>
+
+#include "icmp.hpp"
+#include "ipv4.hpp"
+#include "timestamp.hpp"
+#include "xdp_socket.hpp"
+
+namespace sandor_laboratories
+{
+  namespace pingo
+  {
+    /* Size of each packet slot in the send batch.  Large enough for an ICMP echo request with Pingo payload */
+    #define SEND_ENGINE_SLOT_SIZE_BYTES 64
+
+    /* Headers prepended to each echo request by backends which build the IPv4 header.  Ethernet header is only used by link layer backends */
+    #define SEND_ENGINE_IPV4_HEADER_SIZE_BYTES  IPV4_WORD_SIZE_TO_BYTE_SIZE(IPV4_HEADER_FIXED_SIZE_WORDS)
+    #define SEND_ENGINE_FRAME_HEADER_SIZE_BYTES (sizeof(struct ether_header)+SEND_ENGINE_IPV4_HEADER_SIZE_BYTES)
+
+    /* Sent packets are looped back on the error queue with their TX timestamp, from the link layer header on.
+        Room for an Ethernet header, an IPv4 header with options and a full slot */
+    #define SEND_ENGINE_TX_TIMESTAMP_PACKET_SIZE_BYTES  (sizeof(struct ether_header)+IPV4_WORD_SIZE_TO_BYTE_SIZE(IPV4_HEADER_MAX_SIZE_WORDS)+SEND_ENGINE_SLOT_SIZE_BYTES)
+    /* Room for the timestamp and extended error control messages of one looped packet */
+    #define SEND_ENGINE_TX_TIMESTAMP_CONTROL_SIZE_BYTES 256
+
+    /* Longest backoff between attempts to send one packet, however often it has doubled */
+    #define SEND_ENGINE_MAX_BACKOFF_NS 1000000000UL
+
+    typedef enum
+    {
+      /* Raw IPv4 ICMP socket.  Kernel builds the IPv4 header and routes each packet */
+      SEND_ENGINE_BACKEND_SOCKET,
+      /* Unprivileged ICMP datagram (ping) socket.  Kernel sets the identifier to the bound port and only delivers matching echo replies.
+          Socket is shared with the receiver since replies are demultiplexed to the sending socket */
+      SEND_ENGINE_BACKEND_DATAGRAM,
+      /* Raw IPv4 socket with IP_HDRINCL.  IPv4 headers are written from a template, kernel only routes the packet */
+      SEND_ENGINE_BACKEND_IP_HDRINCL,
+      /* AF_PACKET socket bound to an interface with a memory mapped TPACKET_V2 TX ring.
+          Complete Ethernet frames are built in the ring and transmitted with one syscall per batch */
+      SEND_ENGINE_BACKEND_PACKET_MMAP,
+      /* AF_XDP socket bound to one queue of an interface.  Complete Ethernet frames are built in UMEM frames owned by the engine
+          and handed to the driver through the TX ring.  Socket is shared with the receiver, which reads replies steered to it by an XDP program */
+      SEND_ENGINE_BACKEND_AF_XDP,
+      SEND_ENGINE_BACKEND_MAX,
+    } send_engine_backend_e;
+
+    /* Backends which build complete Ethernet frames and send them from one interface to the gateway */
+    inline bool send_engine_backend_link_layer(send_engine_backend_e backend)
+    {
+      return ((SEND_ENGINE_BACKEND_PACKET_MMAP == backend) || (SEND_ENGINE_BACKEND_AF_XDP == backend));
+    }
+
+    typedef struct
+    {
+      send_engine_backend_e backend;
+      /* Number of packets flushed per sendmmsg() call */
+      unsigned int    batch_size;
+      /* Number of attempts for a packet blocked by EAGAIN or ENOBUFS before it is dropped */
+      unsigned int    send_attempts;
+      /* Initial backoff after EAGAIN or ENOBUFS.  Doubled for every consecutive failed attempt, up to SEND_ENGINE_MAX_BACKOFF_NS.
+          EAGAIN waits up to the backoff for the socket to become writable */
+      struct timespec backoff;
+      /* IPv4 TTL for backends which build the IPv4 header */
+      unsigned int    ttl;
+      /* Link layer backends only.  Destination MAC of the next hop for every frame */
+      uint8_t         gateway_mac[ETHER_ADDR_LEN];
+      /* AF_XDP backend only.  Socket shared by every engine and the receiver, sockfd must be its descriptor */
+      xdp_socket_c   *xdp_socket;
+      /* Reads kernel TX timestamps from the socket error queue after every flush.  Socket must have SO_TIMESTAMPING enabled.
+          Not supported by link layer backends */
+      bool            tx_timestamps;
+    } send_engine_config_s;
+
+    /* Called for every packet dropped by the send engine with the errno which caused the drop */
+    typedef void (*send_engine_drop_cb)(uint32_t dest_address, int error, void * user_data_ptr);
+    /* Called for every TX timestamp read with the ICMP packet it was taken for.  tx_time is in the get_timestamp_ns() timebase */
+    typedef void (*send_engine_tx_timestamp_cb)(uint32_t dest_address, const icmp_buffer_t *icmp_packet, size_t icmp_packet_size, 
+                                                timestamp_ns_t tx_time, void * user_data_ptr);
+
+    typedef struct
+    {
+      /* Packets handed to the kernel */
+      uint_fast64_t sent;
+      /* Send attempts repeated after EAGAIN or ENOBUFS */
+      uint_fast64_t retries;
+      /* Packets given up on */
+      uint_fast64_t drops;
+      /* Kernel TX timestamps read from the error queue */
+      uint_fast64_t tx_timestamps;
+    } send_engine_stats_s;
+
+    class send_engine_c
+    {
+      private:
+        const int                        sockfd;
+        const send_engine_config_s       config;
+        send_engine_drop_cb              drop_cb;
+        void                            *drop_cb_user_data_ptr;
+        send_engine_tx_timestamp_cb      tx_timestamp_cb;
+        void                            *tx_timestamp_cb_user_data_ptr;
+        send_engine_stats_s              stats;
+
+        std::vector<struct mmsghdr>      msg;
+        std::vector<struct iovec>        iov;
+        std::vector<struct sockaddr_in>  dest;
+        std::vector<icmp_buffer_t>       buffer;
+        unsigned int                     queued;
+
+        /* ICMP buffer of every slot.  Slots are used round robin from slot_head so TX ring frames stay in step with the kernel */
+        std::vector<icmp_buffer_t*>      slot_buffer;
+        unsigned int                     slot_head;
+
+        /* PACKET_MMAP TX ring */
+        uint8_t                         *ring;
+        size_t                           ring_size;
+        uint32_t                         source_address;
+        std::vector<struct tpacket2_hdr*> frame;
+        /* Headers in front of every ICMP packet for a destination of 0.0.0.0 and identification of 0.
+            Rebuilt if the ICMP packet size changes.  IPv4 header always ends the packet header */
+        uint8_t                          packet_header[SEND_ENGINE_FRAME_HEADER_SIZE_BYTES];
+        size_t                           packet_header_size;
+        size_t                           packet_header_icmp_size;
+
+        /* UMEM address of the engine's first AF_XDP frame.  Slot i is frame i, iov describes each queued frame */
+        uint64_t                         xdp_frames;
+
+        /* Error queue reads of looped packets carrying TX timestamps */
+        std::vector<struct mmsghdr>      tx_timestamp_msg;
+        std::vector<struct iovec>        tx_timestamp_iov;
+        std::vector<uint8_t>             tx_timestamp_buffer;
+        std::vector<uint8_t>             tx_timestamp_control;
+
+        void                             init_packet_ring();
+        void                             init_xdp_frames();
+        void                             init_ethernet_header(const uint8_t *source_mac);
+        void                             build_packet_header(size_t icmp_packet_size);
+        unsigned int                     flush_socket();
+        unsigned int                     flush_packet_ring();
+        unsigned int                     flush_xdp();
+
+        void                             init_tx_timestamps();
+        void                             tx_timestamp(struct msghdr *, size_t packet_size);
+
+        void                             drop(unsigned int slot, int error);
+        bool                             backoff(int error, unsigned int *remaining_attempts, struct timespec *backoff_time);
+
+      public:
+        send_engine_c(int sockfd, const send_engine_config_s*, send_engine_drop_cb drop_cb = nullptr, void * drop_cb_user_data_ptr = nullptr);
+        ~send_engine_c();
+
+        /* Engines may outlive the owner of the packets they send, such as a sender thread's engine shared across ping blocks */
+        void                   set_drop_cb(send_engine_drop_cb drop_cb, void * drop_cb_user_data_ptr);
+        void                   set_tx_timestamp_cb(send_engine_tx_timestamp_cb tx_timestamp_cb, void * tx_timestamp_cb_user_data_ptr);
+        /* Totals since the engine was created */
+        inline send_engine_stats_s get_stats() const {return stats;};
+
+        /* Buffer of the next free slot.  Packet should be encoded here before calling queue() */
+        inline icmp_buffer_t * get_slot_buffer()     {return slot_buffer[(slot_head+queued)%slot_buffer.size()];};
+        inline size_t          get_slot_size() const {return SEND_ENGINE_SLOT_SIZE_BYTES;};
+        inline bool            is_full()       const {return (queued >= config.batch_size);};
+        inline bool            is_empty()      const {return (0 == queued);};
+        inline unsigned int    get_queued()    const {return queued;};
+
+        /* Queues the packet encoded in the next free slot for dest_address.  Returns false if batch is full.
+            Backends which build the IPv4 header carry probe_id in its identification field so ICMP errors quoting the header can be matched */
+        bool                   queue(uint32_t dest_address, size_t packet_size, uint16_t probe_id = 0);
+        /* Sends all queued packets with as few syscalls as possible.  Returns the number of packets sent */
+        unsigned int           flush();
+        /* Reads every TX timestamp waiting on the error queue without blocking.  flush() calls this after sending if tx_timestamps is configured.
+            Returns the number of timestamps read */
+        unsigned int           read_tx_timestamps();
+    };
+  }
+}
+
+#endif /* __SEND_ENGINE_HPP__ */
\ No newline at end of file
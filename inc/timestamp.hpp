@@ -0,0 +1,88 @@
+#ifndef __TIMESTAMP_HPP__
+#define __TIMESTAMP_HPP__
+
+#include <cstdint>
+#include <ctime>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace sandor_laboratories
+{
+  namespace pingo
+  {
+    typedef uint_fast64_t timestamp_ns_t;
+
+    #define TIMESTAMP_NS_PER_US 1000UL
+    #define TIMESTAMP_NS_PER_S  1000000000UL
+
+    typedef enum
+    {
+      TIMESTAMP_SOURCE_CLOCK_MONOTONIC,
+      TIMESTAMP_SOURCE_TSC,
+      TIMESTAMP_SOURCE_MAX,
+    } timestamp_source_e;
+
+    /* Scaling of TSC ticks to nanoseconds since TSC calibration.  Written once by init_timestamp() before any thread reads it */
+    typedef struct
+    {
+      timestamp_source_e source;
+      uint64_t           base_tsc;
+      timestamp_ns_t     base_ns;
+      /* Nanoseconds per tick in 32.32 fixed point */
+      uint64_t           ns_per_tick;
+    } timestamp_calibration_s;
+
+    extern timestamp_calibration_s timestamp_calibration;
+
+    /* Selects the timestamp source.  Calibrates the TSC against CLOCK_MONOTONIC if the CPU has an invariant TSC.
+        Must be called before threads using get_timestamp_ns() are started, CLOCK_MONOTONIC is used until then */
+    void init_timestamp();
+
+    const char * timestamp_source_string(timestamp_source_e);
+
+    /* Monotonic high resolution timestamp in nanoseconds.  Only differences between timestamps are meaningful */
+    inline timestamp_ns_t get_timestamp_ns()
+    {
+      timestamp_ns_t  ret_val;
+      struct timespec time_now;
+
+      #if defined(__x86_64__) || defined(__i386__)
+      if(TIMESTAMP_SOURCE_TSC == timestamp_calibration.source)
+      {
+        ret_val = timestamp_calibration.base_ns +
+          (timestamp_ns_t)((((unsigned __int128)(__rdtsc()-timestamp_calibration.base_tsc))*timestamp_calibration.ns_per_tick) >> 32);
+      }
+      else
+      #endif
+      {
+        clock_gettime(CLOCK_MONOTONIC, &time_now);
+        ret_val = (((timestamp_ns_t)time_now.tv_sec)*TIMESTAMP_NS_PER_S) + (timestamp_ns_t)time_now.tv_nsec;
+      }
+
+      return ret_val;
+    }
+
+    /* Converts a recent CLOCK_REALTIME time, such as a kernel socket timestamp, to the get_timestamp_ns() timebase.
+        Offset between the clocks is sampled on every call so clock steps only affect times taken before the step */
+    inline timestamp_ns_t timestamp_from_realtime(const struct timespec *realtime)
+    {
+      struct timespec      realtime_now;
+      const timestamp_ns_t timestamp_now = get_timestamp_ns();
+
+      clock_gettime(CLOCK_REALTIME, &realtime_now);
+
+      /* Unsigned arithmetic keeps times slightly ahead of now correct */
+      return timestamp_now - ( ((timestamp_ns_t)(realtime_now.tv_sec-realtime->tv_sec)*TIMESTAMP_NS_PER_S) + 
+                               (timestamp_ns_t)(realtime_now.tv_nsec-realtime->tv_nsec) );
+    }
+
+    /* Timestamp in microseconds truncated to 32 bits.  Wraps every ~71 minutes */
+    inline uint32_t get_timestamp_us32()
+    {
+      return (uint32_t)(get_timestamp_ns()/TIMESTAMP_NS_PER_US);
+    }
+  }
+}
+
+#endif /* __TIMESTAMP_HPP__ */
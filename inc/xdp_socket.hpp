@@ -0,0 +1,116 @@
+#ifndef __XDP_SOCKET_HPP__
+#define __XDP_SOCKET_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <linux/if_xdp.h>
+#include <net/ethernet.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+namespace sandor_laboratories
+{
+  namespace pingo
+  {
+    /* Size of every UMEM frame.  Smallest chunk size the kernel accepts, far larger than any echo reply of interest */
+    #define XDP_SOCKET_FRAME_SIZE_BYTES 2048
+    /* UMEM frames lent to the kernel to receive into */
+    #define XDP_SOCKET_DEFAULT_RX_FRAMES 4096
+
+    typedef struct
+    {
+      /* Interface and queue the socket is bound to.  Replies arriving on other queues are passed to the kernel */
+      char         interface[IF_NAMESIZE];
+      unsigned int queue;
+      /* Copy mode with the XDP program in generic (SKB) mode for drivers without AF_XDP zero-copy support, such as veth */
+      bool         copy_mode;
+      /* ICMP identifier of echo replies steered to the socket */
+      uint16_t     identifier;
+      unsigned int rx_frames;
+      /* UMEM frames handed out with allocate_tx_frames() */
+      unsigned int tx_frames;
+    } xdp_socket_config_s;
+
+    /* Producer/consumer ring shared with the kernel */
+    typedef struct
+    {
+      uint32_t *producer;
+      uint32_t *consumer;
+      void     *descriptors;
+      /* Power of two */
+      uint32_t  size;
+      /* Local copies of the index this side owns */
+      uint32_t  cached_producer;
+      uint32_t  cached_consumer;
+      void     *map;
+      size_t    map_size;
+    } xdp_ring_s;
+
+    /* AF_XDP socket bound to one queue of an interface with a UMEM split into frames to receive into and frames to transmit from.
+        An XDP program on the interface steers ICMP echo replies carrying the identifier into the RX ring, all other traffic reaches the kernel.
+        Receive is single threaded.  Transmit may be shared by several send engines which hold the TX lock around their batches. */
+    class xdp_socket_c
+    {
+      private:
+        const xdp_socket_config_s config;
+        int                       sockfd;
+        unsigned int              ifindex;
+        uint8_t                   source_mac[ETHER_ADDR_LEN];
+        uint32_t                  source_address;
+
+        uint8_t                  *umem;
+        size_t                    umem_size;
+        xdp_ring_s                fill_ring;
+        xdp_ring_s                completion_ring;
+        xdp_ring_s                rx_ring;
+        xdp_ring_s                tx_ring;
+
+        /* Transmit frames follow the receive frames in the UMEM */
+        pthread_mutex_t           tx_mutex = PTHREAD_MUTEX_INITIALIZER;
+        unsigned int              tx_frames_allocated;
+
+        /* XSKMAP the XDP program redirects into, the program and the link attaching it to the interface */
+        int                       map_fd;
+        int                       program_fd;
+        int                       link_fd;
+
+        void                      init_interface();
+        void                      init_umem();
+        void                      map_ring(xdp_ring_s *ring, const struct xdp_ring_offset *offset, uint32_t size, size_t descriptor_size, off_t page_offset);
+        void                      bind_socket();
+        void                      load_program();
+
+      public:
+        static void init_config(xdp_socket_config_s*);
+
+        xdp_socket_c(const xdp_socket_config_s*);
+        ~xdp_socket_c();
+
+        inline int            get_fd() const             {return sockfd;};
+        inline const uint8_t* get_source_mac() const     {return source_mac;};
+        inline uint32_t       get_source_address() const {return source_address;};
+        inline uint8_t*       get_frame(uint64_t frame_address) {return &umem[frame_address];};
+
+        /* Reserves count consecutive UMEM frames for one sender.  Returns the address of the first.  Frames are never returned */
+        uint64_t              allocate_tx_frames(unsigned int count);
+
+        /* Held by a sender from the first tx_queue() until its frames have completed */
+        void                  lock_tx();
+        void                  unlock_tx();
+        /* Places a frame on the TX ring.  Not visible to the kernel until tx_kick().  Returns false if the ring is full */
+        bool                  tx_queue(uint64_t frame_address, uint32_t length);
+        /* Publishes queued frames and wakes the kernel to transmit them.  Returns 0 or the errno of the wakeup */
+        int                   tx_kick();
+        /* Consumes the completion ring.  Returns the number of frames the kernel is done with */
+        unsigned int          tx_complete();
+
+        /* Waits up to timeout_ms for an echo reply and copies it from its IPv4 header on, like recvfrom() on a raw socket.
+            Returns the bytes copied, or -1 with errno set to EWOULDBLOCK on timeout */
+        ssize_t               receive(void *buffer, size_t size, struct sockaddr_in *src_addr, int timeout_ms);
+    };
+  }
+}
+
+#endif /* __XDP_SOCKET_HPP__ */
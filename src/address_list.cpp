@@ -0,0 +1,265 @@
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "address_list.hpp"
+#include "pingo.hpp"
+
+using namespace sandor_laboratories::pingo;
+
+#define ADDRESS_LIST_MAX_PREFIX_LENGTH 32
+#define ADDRESS_LIST_MAX_OCTET         255
+/* Invalid lines printed before only counting them */
+#define ADDRESS_LIST_MAX_REPORTED_INVALID_LINES 16
+
+inline bool address_list_is_space(char c)
+{
+  return ((' ' == c) || ('\t' == c) || ('\r' == c));
+}
+
+inline bool address_list_is_digit(char c)
+{
+  return ((c >= '0') && (c <= '9'));
+}
+
+/* Parses up to three decimal digits no greater than max_value.  Advances cursor past the digits */
+inline bool address_list_parse_decimal(const char **cursor, const char *end, unsigned int max_value, unsigned int *value)
+{
+  const char  *start  = *cursor;
+  unsigned int result = 0;
+
+  while((*cursor < end) && address_list_is_digit(**cursor) && ((*cursor - start) < 3))
+  {
+    result = (result*10) + (unsigned int)(**cursor - '0');
+    (*cursor)++;
+  }
+  *value = result;
+
+  return ((*cursor != start) && (result <= max_value) && ((*cursor >= end) || !address_list_is_digit(**cursor)));
+}
+
+/* Parses a CIDR from the line start..end.  Returns false if the line holds anything else */
+static bool address_list_parse_cidr(const char *start, const char *end, uint32_t *address, uint32_t *subnet_mask)
+{
+  bool         ret_val       = true;
+  const char  *cursor        = start;
+  unsigned int octet         = 0;
+  unsigned int prefix_length = ADDRESS_LIST_MAX_PREFIX_LENGTH;
+
+  *address = 0;
+  for(unsigned int i = 0; ret_val && (i < 4); i++)
+  {
+    if(i > 0)
+    {
+      ret_val = ((cursor < end) && ('.' == *cursor));
+      cursor++;
+    }
+    ret_val = ret_val && address_list_parse_decimal(&cursor, end, ADDRESS_LIST_MAX_OCTET, &octet);
+    *address = ((*address << BITS_8) | octet);
+  }
+
+  if(ret_val && (cursor < end) && ('/' == *cursor))
+  {
+    cursor++;
+    ret_val = address_list_parse_decimal(&cursor, end, ADDRESS_LIST_MAX_PREFIX_LENGTH, &prefix_length);
+  }
+
+  /* Only whitespace or a comment may follow */
+  while(ret_val && (cursor < end) && address_list_is_space(*cursor))
+  {
+    cursor++;
+  }
+  ret_val = ret_val && ((cursor >= end) || ('#' == *cursor));
+
+  *subnet_mask = ((prefix_length > 0)?(uint32_t)(MAX_IP << (ADDRESS_LIST_MAX_PREFIX_LENGTH-prefix_length)):0);
+
+  return ret_val;
+}
+
+static bool address_list_load_text(const char *path, const char *data, size_t size, address_set_c *set, address_list_load_stats_s *stats)
+{
+  const char   *end = (data+size);
+  const char   *line_end;
+  unsigned int  line_number = 1;
+  uint32_t      address;
+  uint32_t      subnet_mask;
+
+  for(const char *line = data; line < end; line = (line_end+1), line_number++)
+  {
+    line_end = (const char*) memchr(line, '\n', (size_t)(end-line));
+    if(nullptr == line_end)
+    {
+      line_end = end;
+    }
+
+    while((line < line_end) && address_list_is_space(*line))
+    {
+      line++;
+    }
+
+    if((line < line_end) && ('#' != *line))
+    {
+      if(address_list_parse_cidr(line, line_end, &address, &subnet_mask))
+      {
+        set->add_subnet(address, subnet_mask);
+        stats->entries++;
+      }
+      else
+      {
+        if(stats->invalid_lines < ADDRESS_LIST_MAX_REPORTED_INVALID_LINES)
+        {
+          fprintf(stderr, "%s line %u: Unexpected IP format.  Expected CIDR format ###.###.###.###/##. - %.*s\n",
+            path, line_number, (int)(line_end-line), line);
+        }
+        stats->invalid_lines++;
+      }
+    }
+  }
+
+  return true;
+}
+
+static bool address_list_load_precompiled(const char *path, const char *data, size_t size, address_set_c *set, address_list_load_stats_s *stats)
+{
+  bool                  ret_val = false;
+  address_list_header_s header;
+  address_range_s       range;
+
+  memcpy(&header, data, sizeof(header));
+
+  if( (ADDRESS_LIST_VERSION_0 == header.version) &&
+      (size == (sizeof(header) + (((size_t)header.range_count)*sizeof(address_range_s)))) )
+  {
+    set->reserve(header.range_count);
+    for(uint32_t i = 0; i < header.range_count; i++)
+    {
+      memcpy(&range, (data + sizeof(header) + (i*sizeof(address_range_s))), sizeof(range));
+      set->add_range(range.first, range.last);
+    }
+    stats->precompiled = true;
+    stats->entries     = header.range_count;
+    ret_val = true;
+  }
+  else
+  {
+    fprintf(stderr, "Precompiled address list '%s' has unsupported version %u or unexpected size %lu.\n",
+      path, header.version, (unsigned long) size);
+  }
+
+  return ret_val;
+}
+
+bool sandor_laboratories::pingo::load_address_list(const char *path, address_set_c *set, address_list_load_stats_s *stats)
+{
+  bool                      ret_val = false;
+  int                       fd;
+  struct stat               file_stat;
+  void                     *data = nullptr;
+  uint64_t                  signature = 0;
+  address_list_load_stats_s local_stats;
+
+  assert(path != nullptr);
+  assert(set != nullptr);
+
+  if(nullptr == stats)
+  {
+    stats = &local_stats;
+  }
+  memset(stats, 0, sizeof(*stats));
+
+  fd = open(path, O_RDONLY);
+  if(fd < 0)
+  {
+    fprintf(stderr, "Failed to open address list '%s'.  errno %u: %s\n", path, errno, strerror(errno));
+  }
+  else if(0 != fstat(fd, &file_stat))
+  {
+    fprintf(stderr, "Failed to stat address list '%s'.  errno %u: %s\n", path, errno, strerror(errno));
+  }
+  else if(0 == file_stat.st_size)
+  {
+    ret_val = true;
+  }
+  else if(MAP_FAILED == (data = mmap(nullptr, (size_t)file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0)))
+  {
+    data = nullptr;
+    fprintf(stderr, "Failed to map address list '%s'.  errno %u: %s\n", path, errno, strerror(errno));
+  }
+  else
+  {
+    /* Read once front to back */
+    madvise(data, (size_t)file_stat.st_size, MADV_SEQUENTIAL);
+
+    if((size_t)file_stat.st_size >= sizeof(address_list_header_s))
+    {
+      memcpy(&signature, data, sizeof(signature));
+    }
+
+    if(ADDRESS_LIST_SIGNATURE == signature)
+    {
+      ret_val = address_list_load_precompiled(path, (const char*) data, (size_t)file_stat.st_size, set, stats);
+    }
+    else
+    {
+      ret_val = address_list_load_text(path, (const char*) data, (size_t)file_stat.st_size, set, stats);
+    }
+
+    if(0 != munmap(data, (size_t)file_stat.st_size))
+    {
+      fprintf(stderr, "Failed to unmap address list '%s'.  errno %u: %s\n", path, errno, strerror(errno));
+    }
+  }
+
+  if((fd >= 0) && (0 != close(fd)))
+  {
+    fprintf(stderr, "Failed to close address list '%s'.  errno %u: %s\n", path, errno, strerror(errno));
+  }
+
+  set->compile();
+
+  return ret_val;
+}
+
+bool sandor_laboratories::pingo::save_address_list(const char *path, const address_set_c *set)
+{
+  bool                  ret_val = false;
+  FILE                 *file_ptr;
+  address_list_header_s header;
+
+  assert(path != nullptr);
+  assert(set != nullptr);
+  assert(set->is_compiled());
+
+  header.signature   = ADDRESS_LIST_SIGNATURE;
+  header.version     = ADDRESS_LIST_VERSION_0;
+  header.range_count = (uint32_t) set->get_range_count();
+
+  if((file_ptr = fopen(path, "wb")) != nullptr)
+  {
+    ret_val = (1 == fwrite(&header, sizeof(header), 1, file_ptr));
+    for(size_t i = 0; ret_val && (i < set->get_range_count()); i++)
+    {
+      ret_val = (1 == fwrite(&set->get_range(i), sizeof(address_range_s), 1, file_ptr));
+    }
+    if(0 != fclose(file_ptr))
+    {
+      ret_val = false;
+    }
+    if(!ret_val)
+    {
+      fprintf(stderr, "Failed to write precompiled address list '%s'.  errno %u: %s\n", path, errno, strerror(errno));
+    }
+  }
+  else
+  {
+    fprintf(stderr, "Failed to open '%s' to write precompiled address list.  errno %u: %s\n", path, errno, strerror(errno));
+  }
+
+  return ret_val;
+}
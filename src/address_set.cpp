@@ -0,0 +1,88 @@
+#include <algorithm>
+#include <cassert>
+
+#include "address_set.hpp"
+
+using namespace sandor_laboratories::pingo;
+
+address_set_c::address_set_c()
+{
+  compiled = true;
+}
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+void address_set_c::add_range(uint32_t first, uint32_t last)
+{
+  const address_range_s range =
+    {
+      .first = ((first <= last)?first:last),
+      .last  = ((first <= last)?last:first),
+    };
+
+  ranges.push_back(range);
+  compiled = false;
+}
+
+void address_set_c::add_subnet(uint32_t address, uint32_t subnet_mask)
+{
+  add_range((address & subnet_mask), (address | ~subnet_mask));
+}
+
+void address_set_c::compile()
+{
+  size_t merged = 0;
+
+  std::sort(ranges.begin(), ranges.end(),
+    [](const address_range_s &a, const address_range_s &b) {return (a.first < b.first);});
+
+  for(size_t i = 0; i < ranges.size(); i++)
+  {
+    /* Merge if range starts at or before the address after the previous range */
+    if((merged > 0) && (((uint_fast64_t)ranges[i].first) <= (((uint_fast64_t)ranges[merged-1].last)+1)))
+    {
+      ranges[merged-1].last = std::max(ranges[merged-1].last, ranges[i].last);
+    }
+    else
+    {
+      ranges[merged] = ranges[i];
+      merged++;
+    }
+  }
+  ranges.resize(merged);
+  ranges.shrink_to_fit();
+
+  compiled = true;
+}
+
+uint_fast64_t address_set_c::get_address_count() const
+{
+  uint_fast64_t count = 0;
+
+  for(const address_range_s &range : ranges)
+  {
+    count += (((uint_fast64_t)range.last - range.first) + 1);
+  }
+
+  return count;
+}
+
+size_t address_set_c::lower_bound(uint32_t address) const
+{
+  assert(compiled);
+
+  return (size_t)(std::lower_bound(ranges.begin(), ranges.end(), address,
+    [](const address_range_s &range, uint32_t value) {return (range.last < value);}) - ranges.begin());
+}
+
+bool address_set_c::contains(uint32_t address, uint32_t *range_last) const
+{
+  const size_t index   = lower_bound(address);
+  const bool   ret_val = ((index < ranges.size()) && (ranges[index].first <= address));
+
+  if(ret_val && (range_last != nullptr))
+  {
+    *range_last = ranges[index].last;
+  }
+
+  return ret_val;
+}
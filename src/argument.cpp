@@ -1,6 +1,7 @@
 #include <cassert>
 #include <cstdio>
 #include <cstring>
+#include <getopt.h>
 #include <unistd.h>
 
 #include "argument.hpp"
@@ -17,7 +18,7 @@ static const char *help_string = PROJECT_NAME " " PROJECT_VER " <" PROJECT_URL "
                                  "  -D: Pixel depth used for creating PNG (1, 2, 4, or 8)\n"
                                  "        Intensity scaled to response time relative to 60 seconds or timeout given with -t\n"
                                  "  -d: Directory to read and write ping data\n"
-                                 "  -e: File containing a list of CIDR address to Exclude from scan (one CIDR per line)\n"
+                                 "  -e: File containing a list of CIDR address to Exclude from scan (one CIDR per line) or a list saved with --save-exclude-list\n"
                                  "  -i: Initial IP address to ping\n"
                                  "  -r: Reserve some number of color channels in PNG palette for user annotation\n"
                                  "        Required to leave a minimum two channels for plotting reply/no reply data ((2^depth)-reserved_channels >= 2)\n"
@@ -25,7 +26,100 @@ static const char *help_string = PROJECT_NAME " " PROJECT_VER " <" PROJECT_URL "
                                  "  -t: Ping block soaking Timeout\n"
                                  "  -v: Validate pingo files at directory and exit\n"
                                  "  -H: Create PNG of Hilbert Curve with given order starting at 0.0.0.0 or IP provided with -i\n"
-                                 "  -h: Display this Help text\n";
+                                 "  -h: Display this Help text\n"
+                                 "  --rate: Target send rate in pings per second.  Replaces the batch cooldown given with -c\n"
+                                 "  --max-rate: Adapt the send rate between --min-rate and this many pings per second\n"
+                                 "        Rate rises after ping blocks sent cleanly, falls after send errors or a drop in reply yield.  Starts at --rate if given\n"
+                                 "  --min-rate: Lowest adapted send rate in pings per second.  1/16 of --max-rate if not given\n"
+                                 "  --send-threads: Number of threads, each with its own socket, sharing the dispatch of every ping block\n"
+                                 "  --permute: Visit addresses of each ping block in a pseudorandom order instead of sequentially\n"
+                                 "  --seed: Seed for the --permute scan order.  Reuse the printed seed to reproduce a scan order\n"
+                                 "  --send-backend: Socket type used to send pings (socket, dgram, ip-hdrincl, packet-mmap, or af-xdp)\n"
+                                 "        dgram uses an unprivileged ICMP datagram socket shared with the receiver, requires net.ipv4.ping_group_range\n"
+                                 "        ip-hdrincl writes IPv4 headers from a template, the identification field carries the address offset in the ping block\n"
+                                 "        packet-mmap builds Ethernet frames in a memory mapped TX ring, requires --interface and --gateway-mac\n"
+                                 "        af-xdp sends and receives through an AF_XDP socket on queue 0 of --interface, bypassing the kernel network stack\n"
+                                 "        An XDP program steers our echo replies to it, so replies on other queues are missed.  Requires --interface and --gateway-mac\n"
+                                 "  --interface: Network interface to send pings from with --send-backend packet-mmap or af-xdp\n"
+                                 "  --gateway-mac: MAC address of the next hop router for --send-backend packet-mmap or af-xdp (xx:xx:xx:xx:xx:xx)\n"
+                                 "  --xdp-copy: Run --send-backend af-xdp in copy mode with generic XDP, for drivers without zero-copy support such as veth\n"
+                                 "  --send-buffer: Socket send buffer size in bytes for sending pings.  Kernel default if not given\n"
+                                 "  --save-exclude-list: Save the list given with -e in a precompiled form which loads faster with -e\n"
+                                 "  --include-list: File listing the only CIDR addresses to scan, in the same forms as -e\n"
+                                 "        Ping blocks without a listed address are skipped, unlisted addresses are recorded as skipped\n"
+                                 "  --scan-reserved: Ping reserved IANA special-purpose address space (private, loopback, multicast, etc) instead of skipping it\n"
+                                 "  --tx-timestamps: Measure ping times from kernel TX timestamps instead of when each ping is built\n"
+                                 "        Excludes rate limiting and socket queueing delay from ping times.  Not supported by --send-backend packet-mmap or af-xdp\n"
+                                 "  --window-blocks: Most ping blocks dispatching or soaking at once.  Sending waits for the oldest to be written\n"
+                                 "  --window-memory: Most memory in MiB held by ping blocks dispatching or soaking at once.  1024 if not given, 0 for no limit\n"
+                                 "  --shard: Scan only shard k of N (k/N, k from 0, N up to 65536), every Nth ping block of the address space\n"
+                                 "        N instances given shards 0/N to N-1/N share a scan without overlap, on one host or many, with the same -s\n"
+                                 "        Ping block size must be a power of two so blocks line up across the address space\n"
+                                 "  --retry-after: Ping addresses which have not replied once more this many seconds after their ping block dispatched\n"
+                                 "        Must be shorter than the soak timeout.  Retries are paced with the first pings by --rate\n"
+                                 "  --rate-per-24: Most pings per second sent into any one /24.  Pings are spread round robin across the /24s and /16s of each ping block\n"
+                                 "  --rate-per-16: Most pings per second sent into any one /16, split between send threads.  Neither may be combined with --permute\n"
+                                 "  --block-duration: Size each ping block from the measured send rate to dispatch in about this many seconds\n"
+                                 "        Sizes are whole /24s from 256 to 1048576 addresses.  -s gives the first block's size.  Not supported with --shard\n"
+                                 "  --prepare-blocks: Ping blocks built on another thread ahead of dispatch, so sending does not stop between blocks.  1 if not given\n"
+                                 "        Prepared blocks count against --window-blocks and --window-memory.  --block-duration sizing lags by as many blocks\n";
+
+/* Options without a short form are numbered after the ASCII range */
+typedef enum
+{
+  PINGO_LONG_OPTION_BASE = 0x100,
+  PINGO_LONG_OPTION_RATE,
+  PINGO_LONG_OPTION_SEND_THREADS,
+  PINGO_LONG_OPTION_PERMUTE,
+  PINGO_LONG_OPTION_SEED,
+  PINGO_LONG_OPTION_SEND_BACKEND,
+  PINGO_LONG_OPTION_INTERFACE,
+  PINGO_LONG_OPTION_GATEWAY_MAC,
+  PINGO_LONG_OPTION_SEND_BUFFER,
+  PINGO_LONG_OPTION_SAVE_EXCLUDE_LIST,
+  PINGO_LONG_OPTION_INCLUDE_LIST,
+  PINGO_LONG_OPTION_SCAN_RESERVED,
+  PINGO_LONG_OPTION_MIN_RATE,
+  PINGO_LONG_OPTION_MAX_RATE,
+  PINGO_LONG_OPTION_TX_TIMESTAMPS,
+  PINGO_LONG_OPTION_WINDOW_BLOCKS,
+  PINGO_LONG_OPTION_WINDOW_MEMORY,
+  PINGO_LONG_OPTION_SHARD,
+  PINGO_LONG_OPTION_RETRY_AFTER,
+  PINGO_LONG_OPTION_XDP_COPY,
+  PINGO_LONG_OPTION_RATE_PER_24,
+  PINGO_LONG_OPTION_RATE_PER_16,
+  PINGO_LONG_OPTION_BLOCK_DURATION,
+  PINGO_LONG_OPTION_PREPARE_BLOCKS,
+} pingo_long_option_e;
+
+static const struct option long_options[] =
+{
+  {"rate",         required_argument, nullptr, PINGO_LONG_OPTION_RATE},
+  {"min-rate",     required_argument, nullptr, PINGO_LONG_OPTION_MIN_RATE},
+  {"max-rate",     required_argument, nullptr, PINGO_LONG_OPTION_MAX_RATE},
+  {"send-threads", required_argument, nullptr, PINGO_LONG_OPTION_SEND_THREADS},
+  {"permute",      no_argument,       nullptr, PINGO_LONG_OPTION_PERMUTE},
+  {"seed",         required_argument, nullptr, PINGO_LONG_OPTION_SEED},
+  {"send-backend", required_argument, nullptr, PINGO_LONG_OPTION_SEND_BACKEND},
+  {"interface",    required_argument, nullptr, PINGO_LONG_OPTION_INTERFACE},
+  {"gateway-mac",  required_argument, nullptr, PINGO_LONG_OPTION_GATEWAY_MAC},
+  {"xdp-copy",     no_argument,       nullptr, PINGO_LONG_OPTION_XDP_COPY},
+  {"send-buffer",  required_argument, nullptr, PINGO_LONG_OPTION_SEND_BUFFER},
+  {"save-exclude-list", required_argument, nullptr, PINGO_LONG_OPTION_SAVE_EXCLUDE_LIST},
+  {"include-list", required_argument, nullptr, PINGO_LONG_OPTION_INCLUDE_LIST},
+  {"scan-reserved", no_argument,      nullptr, PINGO_LONG_OPTION_SCAN_RESERVED},
+  {"tx-timestamps", no_argument,      nullptr, PINGO_LONG_OPTION_TX_TIMESTAMPS},
+  {"window-blocks", required_argument, nullptr, PINGO_LONG_OPTION_WINDOW_BLOCKS},
+  {"window-memory", required_argument, nullptr, PINGO_LONG_OPTION_WINDOW_MEMORY},
+  {"shard",        required_argument, nullptr, PINGO_LONG_OPTION_SHARD},
+  {"retry-after",  required_argument, nullptr, PINGO_LONG_OPTION_RETRY_AFTER},
+  {"rate-per-24",  required_argument, nullptr, PINGO_LONG_OPTION_RATE_PER_24},
+  {"rate-per-16",  required_argument, nullptr, PINGO_LONG_OPTION_RATE_PER_16},
+  {"block-duration", required_argument, nullptr, PINGO_LONG_OPTION_BLOCK_DURATION},
+  {"prepare-blocks", required_argument, nullptr, PINGO_LONG_OPTION_PREPARE_BLOCKS},
+  {nullptr, 0, nullptr, 0},
+};
 
 const char * sandor_laboratories::pingo::get_help_string()
 {
@@ -199,6 +293,342 @@ inline bool parse_option(const int option, pingo_arguments_s* args)
       args->validate_status = PINGO_ARGUMENT_VALID;
       break;
     }
+    case PINGO_LONG_OPTION_RATE:
+    {
+      char dummy;
+      if((sscanf(optarg, "%u%c", &args->ping_block_args.rate, &dummy) == 1) &&
+         (args->ping_block_args.rate > 0))
+      {
+        args->ping_block_args.rate_status = PINGO_ARGUMENT_VALID;
+      }
+      else
+      {
+        args->ping_block_args.rate_status = PINGO_ARGUMENT_INVALID;
+        fprintf(stderr, "--rate %s: send rate format incorrect.  Expected pings per second as positive decimal integer.\n\n", optarg);
+        args->unexpected_arg = true;
+      }
+      break;
+    }
+    case PINGO_LONG_OPTION_MIN_RATE:
+    {
+      char dummy;
+      if((sscanf(optarg, "%u%c", &args->ping_block_args.min_rate, &dummy) == 1) &&
+         (args->ping_block_args.min_rate > 0))
+      {
+        args->ping_block_args.min_rate_status = PINGO_ARGUMENT_VALID;
+      }
+      else
+      {
+        args->ping_block_args.min_rate_status = PINGO_ARGUMENT_INVALID;
+        fprintf(stderr, "--min-rate %s: minimum send rate format incorrect.  Expected pings per second as positive decimal integer.\n\n", optarg);
+        args->unexpected_arg = true;
+      }
+      break;
+    }
+    case PINGO_LONG_OPTION_MAX_RATE:
+    {
+      char dummy;
+      if((sscanf(optarg, "%u%c", &args->ping_block_args.max_rate, &dummy) == 1) &&
+         (args->ping_block_args.max_rate > 0))
+      {
+        args->ping_block_args.max_rate_status = PINGO_ARGUMENT_VALID;
+      }
+      else
+      {
+        args->ping_block_args.max_rate_status = PINGO_ARGUMENT_INVALID;
+        fprintf(stderr, "--max-rate %s: maximum send rate format incorrect.  Expected pings per second as positive decimal integer.\n\n", optarg);
+        args->unexpected_arg = true;
+      }
+      break;
+    }
+    case PINGO_LONG_OPTION_SEND_THREADS:
+    {
+      char dummy;
+      if((sscanf(optarg, "%u%c", &args->ping_block_args.send_threads, &dummy) == 1) &&
+         (args->ping_block_args.send_threads > 0) &&
+         (args->ping_block_args.send_threads <= PINGO_MAX_SEND_THREADS))
+      {
+        args->ping_block_args.send_threads_status = PINGO_ARGUMENT_VALID;
+      }
+      else
+      {
+        args->ping_block_args.send_threads_status = PINGO_ARGUMENT_INVALID;
+        fprintf(stderr, "--send-threads %s: send thread count format incorrect.  Expected decimal integer 1-%u.\n\n", optarg, PINGO_MAX_SEND_THREADS);
+        args->unexpected_arg = true;
+      }
+      break;
+    }
+    case PINGO_LONG_OPTION_PERMUTE:
+    {
+      args->ping_block_args.permute_status = PINGO_ARGUMENT_VALID;
+      break;
+    }
+    case PINGO_LONG_OPTION_SEED:
+    {
+      char dummy;
+      if((sscanf(optarg, "%lu%c", &args->ping_block_args.seed, &dummy) == 1))
+      {
+        args->ping_block_args.seed_status = PINGO_ARGUMENT_VALID;
+      }
+      else
+      {
+        args->ping_block_args.seed_status = PINGO_ARGUMENT_INVALID;
+        fprintf(stderr, "--seed %s: scan order seed format incorrect.  Expected unsigned decimal integer.\n\n", optarg);
+        args->unexpected_arg = true;
+      }
+      break;
+    }
+    case PINGO_LONG_OPTION_SEND_BACKEND:
+    {
+      args->ping_block_args.send_backend_status = PINGO_ARGUMENT_VALID;
+      if(0 == strcmp(optarg, "socket"))
+      {
+        args->ping_block_args.send_backend = SEND_ENGINE_BACKEND_SOCKET;
+      }
+      else if(0 == strcmp(optarg, "dgram"))
+      {
+        args->ping_block_args.send_backend = SEND_ENGINE_BACKEND_DATAGRAM;
+      }
+      else if(0 == strcmp(optarg, "ip-hdrincl"))
+      {
+        args->ping_block_args.send_backend = SEND_ENGINE_BACKEND_IP_HDRINCL;
+      }
+      else if(0 == strcmp(optarg, "packet-mmap"))
+      {
+        args->ping_block_args.send_backend = SEND_ENGINE_BACKEND_PACKET_MMAP;
+      }
+      else if(0 == strcmp(optarg, "af-xdp"))
+      {
+        args->ping_block_args.send_backend = SEND_ENGINE_BACKEND_AF_XDP;
+      }
+      else
+      {
+        args->ping_block_args.send_backend_status = PINGO_ARGUMENT_INVALID;
+        fprintf(stderr, "--send-backend %s: unknown send backend.  Expected socket, dgram, ip-hdrincl, packet-mmap, or af-xdp.\n\n", optarg);
+        args->unexpected_arg = true;
+      }
+      break;
+    }
+    case PINGO_LONG_OPTION_INTERFACE:
+    {
+      if((strlen(optarg) > 0) && (strlen(optarg) < sizeof(args->ping_block_args.interface)))
+      {
+        args->ping_block_args.interface_status = PINGO_ARGUMENT_VALID;
+        memcpy(args->ping_block_args.interface, optarg, strlen(optarg)+1);
+      }
+      else
+      {
+        args->ping_block_args.interface_status = PINGO_ARGUMENT_INVALID;
+        fprintf(stderr, "--interface %s: interface name format incorrect.  Expected 1-%lu characters.\n\n", optarg, (sizeof(args->ping_block_args.interface)-1));
+        args->unexpected_arg = true;
+      }
+      break;
+    }
+    case PINGO_LONG_OPTION_GATEWAY_MAC:
+    {
+      char     dummy;
+      uint8_t *mac = args->ping_block_args.gateway_mac;
+      if(sscanf(optarg, "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx%c", &mac[0], &mac[1], &mac[2], &mac[3], &mac[4], &mac[5], &dummy) == ETHER_ADDR_LEN)
+      {
+        args->ping_block_args.gateway_mac_status = PINGO_ARGUMENT_VALID;
+      }
+      else
+      {
+        args->ping_block_args.gateway_mac_status = PINGO_ARGUMENT_INVALID;
+        fprintf(stderr, "--gateway-mac %s: MAC address format incorrect.  Expected xx:xx:xx:xx:xx:xx.\n\n", optarg);
+        args->unexpected_arg = true;
+      }
+      break;
+    }
+    case PINGO_LONG_OPTION_SEND_BUFFER:
+    {
+      char dummy;
+      if((sscanf(optarg, "%u%c", &args->ping_block_args.send_buffer, &dummy) == 1) &&
+         (args->ping_block_args.send_buffer > 0))
+      {
+        args->ping_block_args.send_buffer_status = PINGO_ARGUMENT_VALID;
+      }
+      else
+      {
+        args->ping_block_args.send_buffer_status = PINGO_ARGUMENT_INVALID;
+        fprintf(stderr, "--send-buffer %s: send buffer size format incorrect.  Expected bytes as positive decimal integer.\n\n", optarg);
+        args->unexpected_arg = true;
+      }
+      break;
+    }
+    case PINGO_LONG_OPTION_SAVE_EXCLUDE_LIST:
+    {
+      if(strlen(optarg) < sizeof(args->ping_block_args.save_exclude_list_path))
+      {
+        args->ping_block_args.save_exclude_list_status = PINGO_ARGUMENT_VALID;
+        memcpy(args->ping_block_args.save_exclude_list_path, optarg, strlen(optarg)+1);
+      }
+      else
+      {
+        args->ping_block_args.save_exclude_list_status = PINGO_ARGUMENT_INVALID;
+        fprintf(stderr, "--save-exclude-list: path too long.  Expected at most %lu characters.\n\n", (sizeof(args->ping_block_args.save_exclude_list_path)-1));
+        args->unexpected_arg = true;
+      }
+      break;
+    }
+    case PINGO_LONG_OPTION_INCLUDE_LIST:
+    {
+      if(strlen(optarg) < sizeof(args->ping_block_args.include_list_path))
+      {
+        args->ping_block_args.include_list_status = PINGO_ARGUMENT_VALID;
+        memcpy(args->ping_block_args.include_list_path, optarg, strlen(optarg)+1);
+      }
+      else
+      {
+        args->ping_block_args.include_list_status = PINGO_ARGUMENT_INVALID;
+        fprintf(stderr, "--include-list: path too long.  Expected at most %lu characters.\n\n", (sizeof(args->ping_block_args.include_list_path)-1));
+        args->unexpected_arg = true;
+      }
+      break;
+    }
+    case PINGO_LONG_OPTION_SCAN_RESERVED:
+    {
+      args->ping_block_args.scan_reserved_status = PINGO_ARGUMENT_VALID;
+      break;
+    }
+    case PINGO_LONG_OPTION_XDP_COPY:
+    {
+      args->ping_block_args.xdp_copy_status = PINGO_ARGUMENT_VALID;
+      break;
+    }
+    case PINGO_LONG_OPTION_TX_TIMESTAMPS:
+    {
+      args->ping_block_args.tx_timestamps_status = PINGO_ARGUMENT_VALID;
+      break;
+    }
+    case PINGO_LONG_OPTION_WINDOW_BLOCKS:
+    {
+      char dummy;
+      if((sscanf(optarg, "%u%c", &args->ping_block_args.window_blocks, &dummy) == 1) &&
+         (args->ping_block_args.window_blocks > 0))
+      {
+        args->ping_block_args.window_blocks_status = PINGO_ARGUMENT_VALID;
+      }
+      else
+      {
+        args->ping_block_args.window_blocks_status = PINGO_ARGUMENT_INVALID;
+        fprintf(stderr, "--window-blocks %s: ping block window format incorrect.  Expected count as positive decimal integer.\n\n", optarg);
+        args->unexpected_arg = true;
+      }
+      break;
+    }
+    case PINGO_LONG_OPTION_RETRY_AFTER:
+    {
+      char dummy;
+      if((sscanf(optarg, "%u%c", &args->ping_block_args.retry_after, &dummy) == 1) &&
+         (args->ping_block_args.retry_after > 0))
+      {
+        args->ping_block_args.retry_after_status = PINGO_ARGUMENT_VALID;
+      }
+      else
+      {
+        args->ping_block_args.retry_after_status = PINGO_ARGUMENT_INVALID;
+        fprintf(stderr, "--retry-after %s: retry delay format incorrect.  Expected seconds as positive decimal integer.\n\n", optarg);
+        args->unexpected_arg = true;
+      }
+      break;
+    }
+    case PINGO_LONG_OPTION_RATE_PER_24:
+    {
+      char dummy;
+      if((sscanf(optarg, "%u%c", &args->ping_block_args.rate_per_24, &dummy) == 1) &&
+         (args->ping_block_args.rate_per_24 > 0))
+      {
+        args->ping_block_args.rate_per_24_status = PINGO_ARGUMENT_VALID;
+      }
+      else
+      {
+        args->ping_block_args.rate_per_24_status = PINGO_ARGUMENT_INVALID;
+        fprintf(stderr, "--rate-per-24 %s: prefix rate format incorrect.  Expected pings per second as positive decimal integer.\n\n", optarg);
+        args->unexpected_arg = true;
+      }
+      break;
+    }
+    case PINGO_LONG_OPTION_RATE_PER_16:
+    {
+      char dummy;
+      if((sscanf(optarg, "%u%c", &args->ping_block_args.rate_per_16, &dummy) == 1) &&
+         (args->ping_block_args.rate_per_16 > 0))
+      {
+        args->ping_block_args.rate_per_16_status = PINGO_ARGUMENT_VALID;
+      }
+      else
+      {
+        args->ping_block_args.rate_per_16_status = PINGO_ARGUMENT_INVALID;
+        fprintf(stderr, "--rate-per-16 %s: prefix rate format incorrect.  Expected pings per second as positive decimal integer.\n\n", optarg);
+        args->unexpected_arg = true;
+      }
+      break;
+    }
+    case PINGO_LONG_OPTION_BLOCK_DURATION:
+    {
+      char dummy;
+      if((sscanf(optarg, "%u%c", &args->ping_block_args.block_duration, &dummy) == 1) &&
+         (args->ping_block_args.block_duration > 0))
+      {
+        args->ping_block_args.block_duration_status = PINGO_ARGUMENT_VALID;
+      }
+      else
+      {
+        args->ping_block_args.block_duration_status = PINGO_ARGUMENT_INVALID;
+        fprintf(stderr, "--block-duration %s: dispatch duration format incorrect.  Expected seconds as positive decimal integer.\n\n", optarg);
+        args->unexpected_arg = true;
+      }
+      break;
+    }
+    case PINGO_LONG_OPTION_PREPARE_BLOCKS:
+    {
+      char dummy;
+      if((sscanf(optarg, "%u%c", &args->ping_block_args.prepare_blocks, &dummy) == 1) &&
+         (args->ping_block_args.prepare_blocks > 0))
+      {
+        args->ping_block_args.prepare_blocks_status = PINGO_ARGUMENT_VALID;
+      }
+      else
+      {
+        args->ping_block_args.prepare_blocks_status = PINGO_ARGUMENT_INVALID;
+        fprintf(stderr, "--prepare-blocks %s: prepared ping block format incorrect.  Expected count as positive decimal integer.\n\n", optarg);
+        args->unexpected_arg = true;
+      }
+      break;
+    }
+    case PINGO_LONG_OPTION_SHARD:
+    {
+      char dummy;
+      if((sscanf(optarg, "%u/%u%c", &args->ping_block_args.shard, &args->ping_block_args.shard_count, &dummy) == 2) &&
+         (args->ping_block_args.shard < args->ping_block_args.shard_count) &&
+         (args->ping_block_args.shard_count <= PINGO_SHARD_COUNT_MAX))
+      {
+        args->ping_block_args.shard_status = PINGO_ARGUMENT_VALID;
+      }
+      else
+      {
+        args->ping_block_args.shard_status = PINGO_ARGUMENT_INVALID;
+        fprintf(stderr, "--shard %s: shard format incorrect.  Expected k/N with k from 0 to N-1 and N up to %u.\n\n", optarg, PINGO_SHARD_COUNT_MAX);
+        args->unexpected_arg = true;
+      }
+      break;
+    }
+    case PINGO_LONG_OPTION_WINDOW_MEMORY:
+    {
+      char dummy;
+      if((sscanf(optarg, "%u%c", &args->ping_block_args.window_memory, &dummy) == 1))
+      {
+        args->ping_block_args.window_memory_status = PINGO_ARGUMENT_VALID;
+      }
+      else
+      {
+        args->ping_block_args.window_memory_status = PINGO_ARGUMENT_INVALID;
+        fprintf(stderr, "--window-memory %s: ping block window format incorrect.  Expected MiB as decimal integer.\n\n", optarg);
+        args->unexpected_arg = true;
+      }
+      break;
+    }
     case '?':
     {
       args->unexpected_arg = true;
@@ -223,13 +653,88 @@ bool sandor_laboratories::pingo::parse_pingo_args(int argc, char *argv[], pingo_
   {
     memset(args, 0, sizeof(pingo_arguments_s));
 
-    while((option = getopt(argc, argv, "Aa:c:D:d:e:H:hi:r:s:t:v")) !=  -1)
+    while((option = getopt_long(argc, argv, "Aa:c:D:d:e:H:hi:r:s:t:v", long_options, nullptr)) !=  -1)
     {
       if(!parse_option(option, args))
       {
         ret_val = false;
       }
     }
+
+    if( (PINGO_ARGUMENT_VALID == args->ping_block_args.send_backend_status) &&
+        send_engine_backend_link_layer(args->ping_block_args.send_backend) &&
+        ((PINGO_ARGUMENT_VALID != args->ping_block_args.interface_status) ||
+         (PINGO_ARGUMENT_VALID != args->ping_block_args.gateway_mac_status)) )
+    {
+      fprintf(stderr, "--send-backend packet-mmap and af-xdp: require --interface and --gateway-mac.\n\n");
+      args->unexpected_arg = true;
+    }
+
+    if( (PINGO_ARGUMENT_VALID == args->ping_block_args.xdp_copy_status) &&
+        ((PINGO_ARGUMENT_VALID != args->ping_block_args.send_backend_status) ||
+         (SEND_ENGINE_BACKEND_AF_XDP != args->ping_block_args.send_backend)) )
+    {
+      fprintf(stderr, "--xdp-copy: requires --send-backend af-xdp.\n\n");
+      args->unexpected_arg = true;
+    }
+
+    if( (PINGO_ARGUMENT_VALID == args->ping_block_args.min_rate_status) &&
+        ( (PINGO_ARGUMENT_VALID != args->ping_block_args.max_rate_status) ||
+          (args->ping_block_args.min_rate > args->ping_block_args.max_rate) ) )
+    {
+      fprintf(stderr, "--min-rate: requires --max-rate no lower than --min-rate.\n\n");
+      args->unexpected_arg = true;
+    }
+
+    if( (PINGO_ARGUMENT_VALID == args->ping_block_args.save_exclude_list_status) &&
+        (PINGO_ARGUMENT_VALID != args->ping_block_args.exclude_list_status) )
+    {
+      fprintf(stderr, "--save-exclude-list: requires -e.\n\n");
+      args->unexpected_arg = true;
+    }
+
+    if( (PINGO_ARGUMENT_VALID == args->ping_block_args.tx_timestamps_status) &&
+        (PINGO_ARGUMENT_VALID == args->ping_block_args.send_backend_status) &&
+        send_engine_backend_link_layer(args->ping_block_args.send_backend) )
+    {
+      fprintf(stderr, "--tx-timestamps: not supported by --send-backend packet-mmap or af-xdp.\n\n");
+      args->unexpected_arg = true;
+    }
+
+    if( (PINGO_ARGUMENT_VALID == args->ping_block_args.retry_after_status) &&
+        (args->ping_block_args.retry_after >= ((PINGO_ARGUMENT_VALID == args->writer_args.soak_timeout_status)?
+                                               args->writer_args.soak_timeout:PINGO_DEFAULT_SOAK_TIMEOUT)) )
+    {
+      fprintf(stderr, "--retry-after: requires a retry delay shorter than the soak timeout.\n\n");
+      args->unexpected_arg = true;
+    }
+
+    if( (PINGO_ARGUMENT_VALID == args->ping_block_args.permute_status) &&
+        ((PINGO_ARGUMENT_VALID == args->ping_block_args.rate_per_24_status) ||
+         (PINGO_ARGUMENT_VALID == args->ping_block_args.rate_per_16_status)) )
+    {
+      fprintf(stderr, "--rate-per-24 and --rate-per-16: order pings by prefix and cannot be combined with --permute.\n\n");
+      args->unexpected_arg = true;
+    }
+
+    if( (PINGO_ARGUMENT_VALID == args->ping_block_args.block_duration_status) &&
+        (PINGO_ARGUMENT_VALID == args->ping_block_args.shard_status) )
+    {
+      fprintf(stderr, "--block-duration: not supported with --shard, which requires every instance to use the same ping block size.\n\n");
+      args->unexpected_arg = true;
+    }
+
+    if(PINGO_ARGUMENT_VALID == args->ping_block_args.shard_status)
+    {
+      const uint_fast64_t address_length = ((PINGO_ARGUMENT_VALID == args->ping_block_args.address_length_status)?
+                                            args->ping_block_args.address_length:PINGO_DEFAULT_PING_BLOCK_SIZE);
+      if( (0 == address_length) || (0 != (address_length & (address_length-1))) ||
+          (args->ping_block_args.shard_count > ((MAX_IP+1ULL)/address_length)) )
+      {
+        fprintf(stderr, "--shard: requires a power of two ping block size with at least as many ping blocks in the address space as shards.\n\n");
+        args->unexpected_arg = true;
+      }
+    }
   }
   else
   {
@@ -36,7 +36,7 @@ bool file_manager_c::file_header_valid(const file_s* file)
   if(file != nullptr)
   {
     ret_val = ( (FILE_SIGNATURE == file->header.signature) &&
-                (FILE_VERSION_0 == file->header.version) && 
+                ((FILE_VERSION_0 == file->header.version) || (FILE_VERSION_1 == file->header.version)) && 
                 (file->header.address_count > 0));
   }
   else
@@ -321,17 +321,18 @@ file_stats_s file_manager_c::get_stats_from_file(const file_s* file)
   {
     for(unsigned int i = 0; i < file->header.address_count; i++)
     {
-      if(FILE_DATA_ENTRY_ECHO_REPLY == file->data[i].type)
+      if(file_data_entry_is_reply(&file->data[i]))
       {
+        const reply_time_t reply_time = file_data_entry_reply_time(&file->data[i]);
         stats.valid_replies++;
-        mean_accumulator += file->data[i].payload.echo_reply.reply_time;
-        if(file->data[i].payload.echo_reply.reply_time < stats.min_reply_time)
+        mean_accumulator += reply_time;
+        if(reply_time < stats.min_reply_time)
         {
-          stats.min_reply_time = file->data[i].payload.echo_reply.reply_time;
+          stats.min_reply_time = reply_time;
         }
-        if(file->data[i].payload.echo_reply.reply_time > stats.max_reply_time)
+        if(reply_time > stats.max_reply_time)
         {
-          stats.max_reply_time = file->data[i].payload.echo_reply.reply_time;
+          stats.max_reply_time = reply_time;
         }
       }
       else if(FILE_DATA_ENTRY_ECHO_SKIPPED == file->data[i].type)
@@ -413,8 +414,11 @@ bool file_manager_c::file_path_from_directory_filename(const char * directory, c
   return ret_val;
 }
 
-inline void fill_file_data(file_s *file, ping_block_c* ping_block)
+/* Returns the oldest file version able to hold the data entries filled */
+inline file_version_e fill_file_data(file_s *file, ping_block_c* ping_block)
 {
+  file_version_e version = FILE_VERSION_0;
+
   assert(file != nullptr);
   assert(ping_block != nullptr);
 
@@ -424,7 +428,13 @@ inline void fill_file_data(file_s *file, ping_block_c* ping_block)
   {
     ping_block_entry_s ping_block_entry;
     assert(ping_block->get_ping_block_entry((ping_block->get_first_address()+i), &ping_block_entry));
-    if(ping_block_entry.reply_valid)
+    if(ping_block_entry.reply_valid && (ping_block_entry.ping_time_us < FILE_ECHO_REPLY_TIME_US_MAX))
+    {
+      file->data[i].type = FILE_DATA_ENTRY_ECHO_REPLY_US;
+      file->data[i].payload.echo_reply_us.reply_time_us = ping_block_entry.ping_time_us;
+      version = FILE_VERSION_1;
+    }
+    else if(ping_block_entry.reply_valid)
     {
       file->data[i].type = FILE_DATA_ENTRY_ECHO_REPLY;
       file->data[i].payload.echo_reply.reply_time = 
@@ -436,6 +446,10 @@ inline void fill_file_data(file_s *file, ping_block_c* ping_block)
       file->data[i].payload.echo_skipped.reason     = (file_data_entry_payload_echo_skip_reason_e) ping_block_entry.skip_reason;
       file->data[i].payload.echo_skipped.error_code = 
         ((((unsigned int) ping_block_entry.skip_errno) < FILE_ECHO_SKIPPED_ERROR_CODE_MAX)?ping_block_entry.skip_errno:FILE_ECHO_SKIPPED_ERROR_CODE_MAX);
+      if(file->data[i].payload.echo_skipped.reason >= FILE_DATA_ENTRY_ECHO_SKIP_REASON_NOT_INCLUDED)
+      {
+        version = FILE_VERSION_1;
+      }
     }
     else
     {
@@ -443,6 +457,8 @@ inline void fill_file_data(file_s *file, ping_block_c* ping_block)
       file->data[i].payload.echo_reply.reply_time = FILE_ECHO_REPLY_TIME_MAX;
     }
   }
+
+  return version;
 }
 
 inline bool write_file(const file_s *file, const char * path)
@@ -487,12 +503,11 @@ bool file_manager_c::write_ping_block_to_file(ping_block_c* ping_block)
       memset(&file, 0, sizeof(file));
       /* Build header */
       file.header.signature     = FILE_SIGNATURE;
-      file.header.version       = FILE_VERSION_0;
       file.header.first_address = ping_block->get_first_address();
       file.header.address_count = ping_block->get_address_count();
 
-      /* Fill data */
-      fill_file_data(&file, ping_block);
+      /* Fill data.  Microsecond entries need a version 1 reader */
+      file.header.version       = fill_file_data(&file, ping_block);
 
      /* Fill checksum */
       generate_file_checksum(&file, file.checksum);
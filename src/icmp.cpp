@@ -256,4 +256,28 @@ size_t encode_icmp_packet(const icmp_packet_meta_s* icmp_packet_meta, icmp_buffe
   }
 
   return output_size;
+}
+
+bool init_icmp_packet_template(const icmp_packet_meta_s* icmp_packet_meta, icmp_packet_template_s* packet_template)
+{
+  bool ret_val = true;
+
+  if((icmp_packet_meta != nullptr) && (packet_template != nullptr))
+  {
+    memset(packet_template, 0, sizeof(icmp_packet_template_s));
+    packet_template->size = encode_icmp_packet(icmp_packet_meta, packet_template->buffer, sizeof(packet_template->buffer));
+    if(packet_template->size < ICMP_HEADER_SIZE_BYTES)
+    {
+      fprintf(stderr, "Failed to encode ICMP packet template.  size %lu\n", packet_template->size);
+      ret_val = false;
+    }
+  }
+  else
+  {
+    fprintf(stderr, "Null inputs to init ICMP packet template.  icmp_packet_meta 0x%p packet_template 0x%p\n",
+            icmp_packet_meta, packet_template);
+    ret_val = false;
+  }
+
+  return ret_val;
 }
\ No newline at end of file
@@ -121,16 +121,16 @@ void fill_hilbert_image_from_file(const file_s* file, const void * user_data_ptr
   for(uint_fast64_t i = MAX(params->png_config->initial_ip, file->header.first_address); i < MIN(last_ip, file_last_ip); i++)
   {
     const file_data_entry_s * file_data_entry = &file->data[(i-file->header.first_address)]; 
-    if(FILE_DATA_ENTRY_ECHO_REPLY == file_data_entry->type)
+    if(file_data_entry_is_reply(file_data_entry))
     {
       const hilbert_index_t hilbert_index = (i-params->png_config->initial_ip);
       hilbert_coordinate_s  coordinate;
       assert(params->hilbert_curve->get_coordinate(hilbert_index, &coordinate));
 
       unsigned int value = 1;
-      if(file_data_entry->payload.echo_reply.reply_time < params->png_config->depth_scale_reference)
+      if(file_data_entry_reply_time(file_data_entry) < params->png_config->depth_scale_reference)
       {
-        value = max_value - ((file_data_entry->payload.echo_reply.reply_time * max_value)/params->png_config->depth_scale_reference);
+        value = max_value - ((file_data_entry_reply_time(file_data_entry) * max_value)/params->png_config->depth_scale_reference);
       }
       set_image_pixel(params->row_pointers, params->png_config->color_depth, max_coordinate, coordinate.x, coordinate.y, value);
     }
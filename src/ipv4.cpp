@@ -100,6 +100,11 @@ ipv4_packet_meta_s parse_ipv4_packet(const ipv4_word_t * buffer, const size_t bu
     packet_meta.buffer_size = buffer_size;
 
     packet_meta.header_valid = parse_ipv4_header(buffer, buffer_size, &packet_meta.header);
+    /* Packets cut short by the receive slot are not echo replies of interest, dropped without a message per packet */
+    if(packet_meta.header_valid && (packet_meta.header.total_length > buffer_size))
+    {
+      packet_meta.header_valid = false;
+    }
 
     if(packet_meta.header_valid && (packet_meta.header.ihl < BYTE_SIZE_TO_IPV4_WORD_SIZE(buffer_size)))
     {
@@ -179,7 +184,8 @@ size_t encode_ipv4_packet(const ipv4_packet_meta_s* packet_meta, ipv4_word_t * b
 
       // NOLINTBEGIN(readability-magic-numbers)
       computed_checksum = (computed_checksum & 0xFFFF) + (computed_checksum>>16);
-      host_word = ntohl(buffer[2]) | (computed_checksum & 0xFFFF);
+      computed_checksum = (computed_checksum & 0xFFFF) + (computed_checksum>>16);
+      host_word = ntohl(buffer[2]) | ((~computed_checksum) & 0xFFFF);
       buffer[2] = htonl(host_word);
       // NOLINTEND(readability-magic-numbers)
 
@@ -1,8 +1,15 @@
+#include <arpa/inet.h>
 #include <cassert>
 #include <cerrno>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <ctime>
+/* net/if.h before linux/icmp.h so the kernel's linux/if.h defers to it */
+#include <net/if.h>
+#include <linux/icmp.h>
+#include <linux/if_ether.h>
+#include <linux/net_tstamp.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
 #include <unistd.h>
@@ -10,6 +17,10 @@
 #include "icmp.hpp"
 #include "ping_block.hpp"
 #include "pingo.hpp"
+#include "reserved_address.hpp"
+#include "scan_order.hpp"
+#include "send_engine.hpp"
+#include "timestamp.hpp"
 
 using namespace sandor_laboratories::pingo;
 
@@ -25,10 +36,29 @@ static const ping_block_config_s default_ping_block_config =
       },
     .socket_ttl      = 255,
     .identifier      = ICMP_IDENTIFIER,
-    .fixed_sequence_number = false,
-    .sequence_number = 0,
+    .cookie_key      = {.k0 = 0, .k1 = 0},
     .send_attempts   = 5,
-    .excluded_ip_list = nullptr,
+    .send_backoff    =
+      {
+        .tv_sec  = 0,
+        .tv_nsec = 50000,
+      },
+    .socket_send_buffer = 0,
+    .exclude_set      = nullptr,
+    .include_set      = nullptr,
+    .skip_reserved    = true,
+    .rate_limiter     = nullptr,
+    .scan_order       = SCAN_ORDER_SEQUENTIAL,
+    .scan_seed        = 0,
+    .prefix_caps      = {.max_rate_24 = 0, .max_rate_16 = 0},
+    .send_backend     = SEND_ENGINE_BACKEND_SOCKET,
+    .send_interface   = "",
+    .gateway_mac      = {0},
+    .xdp_socket       = nullptr,
+    .tx_timestamps    = false,
+    .foreign_tx_timestamp_cb            = nullptr,
+    .foreign_tx_timestamp_user_data_ptr = nullptr,
+    .retry_delay      = {.tv_sec = 0, .tv_nsec = 0},
   };
 // NOLINTEND(readability-magic-numbers)
 
@@ -59,38 +89,33 @@ ping_block_c::ping_block_c(uint32_t first_address, unsigned int address_count, c
 
   dispatch_started = false;
   fully_dispatched = false;
+  dispatch_shard_count = 0;
+  shards_started   = 0;
+  shards_done      = 0;
   memset(&dispatch_start_time, 0, sizeof(dispatch_start_time));
   memset(&dispatch_done_time,  0, sizeof(dispatch_done_time));
   memset(&dispatch_time,       0, sizeof(dispatch_time));
+  memset(&dispatch_stats,      0, sizeof(dispatch_stats));
+  retry_started    = false;
+  retry_done       = false;
 
   entry = (ping_block_entry_s*) calloc(address_count, sizeof(ping_block_entry_s));
 
   for(unsigned int i = 0; i < address_count; i++)
   {
-    entry[i].ping_time = PINGO_BLOCK_PING_TIME_NO_RESPONSE;
+    entry[i].ping_time    = PINGO_BLOCK_PING_TIME_NO_RESPONSE;
+    entry[i].ping_time_us = PINGO_BLOCK_PING_TIME_NO_RESPONSE;
   }
 
-  if(config.excluded_ip_list != nullptr)
+  /* Blocks clear of every excluded range skip the lookup during dispatch */
+  exclude_set_overlaps = false;
+  assert((nullptr == config.include_set) || config.include_set->is_compiled());
+  if((config.exclude_set != nullptr) && (address_count > 0))
   {
-    for(ping_block_excluded_ip_list_t::iterator it = config.excluded_ip_list->begin(); it != config.excluded_ip_list->end(); it++)
-    {
-      if( ((it->ip | (~it->subnet_mask)) >= get_first_address()) &&
-          ((it->ip & ( it->subnet_mask)) <  get_last_address()) )
-      {
-        const ping_block_excluded_ip_s excluded_ip = 
-          {
-            .ip          = (it->ip & it->subnet_mask),
-            .subnet_mask = it->subnet_mask, 
-          };
-        excluded_ip_list.push_back(excluded_ip);
-
-        char ip_string_buffer[IP_STRING_SIZE];
-        char subnet_string_buffer[IP_STRING_SIZE];
-        ip_string(excluded_ip.ip, ip_string_buffer, sizeof(ip_string_buffer));
-        ip_string(excluded_ip.subnet_mask, subnet_string_buffer, sizeof(ip_string_buffer));
-        printf("Excluding IP %s with subnet mask %s from ping block.\n", ip_string_buffer, subnet_string_buffer);
-      }
-    }
+    assert(config.exclude_set->is_compiled());
+    const size_t range_index = config.exclude_set->lower_bound(get_first_address());
+    exclude_set_overlaps = ( (range_index < config.exclude_set->get_range_count()) &&
+                             (config.exclude_set->get_range(range_index).first <= (get_first_address()+(address_count-1))) );
   }
 
   unlock();
@@ -111,7 +136,7 @@ ping_block_c::~ping_block_c()
 }
 
 // NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
-bool ping_block_c::log_ping_time(uint32_t address, reply_time_t reply_delay)
+bool ping_block_c::log_ping_time(uint32_t address, uint32_t reply_delay_us)
 {
   bool ret_val = false;
   ping_block_entry_s* log_entry = nullptr;
@@ -127,9 +152,14 @@ bool ping_block_c::log_ping_time(uint32_t address, reply_time_t reply_delay)
 
     log_entry->reply_valid = true;
     
-    log_entry->ping_time = 
-      (reply_delay<PINGO_BLOCK_PING_TIME_NO_RESPONSE)?
-       reply_delay:PINGO_BLOCK_PING_TIME_NO_RESPONSE;
+    if(log_entry->send_delay_us < reply_delay_us)
+    {
+      reply_delay_us -= log_entry->send_delay_us;
+    }
+    log_entry->ping_time    = (reply_delay_us/1000);
+    log_entry->ping_time_us = 
+      (reply_delay_us<PINGO_BLOCK_PING_TIME_NO_RESPONSE)?
+       reply_delay_us:PINGO_BLOCK_PING_TIME_NO_RESPONSE;
 
     unlock();
   }
@@ -163,158 +193,505 @@ bool ping_block_c::get_ping_block_entry(uint32_t address, ping_block_entry_s* re
   return ret_val;
 }
 
-bool ping_block_c::dispatch()
+void ping_block_c::dispatch_drop_cb(uint32_t dest_address, int error, void * user_data_ptr)
 {
-  bool ret_val = false;
+  ping_block_c *ping_block = (ping_block_c*) user_data_ptr;
+  char          ip_string_buffer[IP_STRING_SIZE];
+
+  assert(ping_block != nullptr);
+
+  ip_string(dest_address, ip_string_buffer, sizeof(ip_string_buffer));
+  fprintf(stderr, "Failed to send ping for IP %s to socket.  errno %u: %s\n", ip_string_buffer, error, strerror(error));
+
+  ping_block->lock();
+  assert((dest_address >= ping_block->get_first_address()) && ((dest_address-ping_block->get_first_address()) < ping_block->get_address_count()));
+  ping_block->entry[(dest_address-ping_block->get_first_address())] = 
+    {
+      .reply_valid = false,
+      .retried     = ping_block->entry[(dest_address-ping_block->get_first_address())].retried,
+      .ping_time   = PINGO_BLOCK_PING_TIME_NO_RESPONSE,
+      .ping_time_us = PINGO_BLOCK_PING_TIME_NO_RESPONSE,
+      .send_delay_us = 0,
+      .skip_reason = PING_BLOCK_IP_SKIP_REASON_SOCKET_ERROR,
+      .skip_errno  = error,
+    };
+  ping_block->unlock();
+}
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+void ping_block_c::dispatch_tx_timestamp_cb(uint32_t dest_address, const icmp_buffer_t *icmp_packet, size_t icmp_packet_size, 
+                                            timestamp_ns_t tx_time, void * user_data_ptr)
+{
+  ping_block_c *ping_block = (ping_block_c*) user_data_ptr;
 
-  int                 sockfd = socket(AF_INET, SOCK_RAW, IPPROTO_ICMP);
-  unsigned int        batch_index = 0;
-  unsigned int        packet_id = 0;
-  icmp_packet_meta_s  icmp_packet_meta;
+  assert(ping_block != nullptr);
+
+  /* Timestamps left on the error queue by an earlier ping block, or read for another block sharing the socket */
+  if( !ping_block->log_tx_timestamp(dest_address, icmp_packet, icmp_packet_size, tx_time) &&
+      (ping_block->config.foreign_tx_timestamp_cb != nullptr) )
+  {
+    ping_block->config.foreign_tx_timestamp_cb(dest_address, icmp_packet, icmp_packet_size, tx_time, 
+                                               ping_block->config.foreign_tx_timestamp_user_data_ptr);
+  }
+}
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+bool ping_block_c::log_tx_timestamp(uint32_t dest_address, const icmp_buffer_t *icmp_packet, size_t icmp_packet_size, timestamp_ns_t tx_time)
+{
+  bool                ret_val = false;
+  ping_block_entry_s *tx_entry;
   pingo_payload_t     pingo_payload;
-  uint32_t            dest_address = get_first_address();
-  struct sockaddr_in  send_sockaddr;
-  struct timespec     temp_time;
-  char                ip_string_buffer[IP_STRING_SIZE];
-  ipv4_word_t         buffer[IPV4_MAX_PACKET_SIZE_WORDS];
-  unsigned int        remaining_attempts;
+  uint32_t            send_delay_us;
 
-  get_time(&temp_time);
+  if( (dest_address >= get_first_address()) &&
+      ((dest_address-get_first_address()) < get_address_count()) )
+  {
+    ret_val = true;
+  }
 
-  if(!is_dispatch_started())
+  if( ret_val &&
+      (icmp_packet_size == (ICMP_PAYLOAD_OFFSET_BYTES+sizeof(pingo_payload))) && 
+      (ICMP_TYPE_ECHO_REQUEST == icmp_packet[0]) )
   {
-    dispatch_started = true;
-    dispatch_start_time = temp_time;
+    memcpy(&pingo_payload, &icmp_packet[ICMP_PAYLOAD_OFFSET_BYTES], sizeof(pingo_payload));
+    send_delay_us = ((uint32_t)(tx_time/TIMESTAMP_NS_PER_US) - pingo_payload.request_time);
 
-    memset(&pingo_payload, 0, sizeof(pingo_payload));
+    lock();
+    tx_entry = &entry[(dest_address-get_first_address())];
+    if((0 == tx_entry->send_delay_us) && (send_delay_us <= PINGO_PAYLOAD_MAX_AGE_US))
+    {
+      tx_entry->send_delay_us = send_delay_us;
 
-    memset(&send_sockaddr, 0, sizeof(send_sockaddr));
-    send_sockaddr.sin_family = AF_INET;
-    send_sockaddr.sin_port   = htons(IPPROTO_ICMP);
+      /* Reply was logged before the TX timestamp was read */
+      if(tx_entry->reply_valid && (tx_entry->ping_time_us != PINGO_BLOCK_PING_TIME_NO_RESPONSE) && (send_delay_us < tx_entry->ping_time_us))
+      {
+        tx_entry->ping_time_us -= send_delay_us;
+        tx_entry->ping_time     = (tx_entry->ping_time_us/1000);
+      }
+    }
+    unlock();
+  }
 
-    memset(&icmp_packet_meta, 0, sizeof(icmp_packet_meta_s));
-    icmp_packet_meta.header.type = ICMP_TYPE_ECHO_REQUEST;
-    icmp_packet_meta.header.code = ICMP_CODE_ZERO;
-    icmp_packet_meta.header.rest_of_header.id_seq_num.identifier = config.identifier;
-    icmp_packet_meta.header_valid = true;
-    icmp_packet_meta.payload = (icmp_buffer_t*) &pingo_payload;
-    icmp_packet_meta.payload_size = sizeof(pingo_payload_t);
+  return ret_val;
+}
+
+int ping_block_c::open_socket(const ping_block_config_s *socket_config)
+{
+  int                sockfd;
+  struct sockaddr_ll link_address;
+  struct sockaddr_in inet_address;
+
+  assert(socket_config != nullptr);
 
-    if(sockfd == -1)
+  if(SEND_ENGINE_BACKEND_PACKET_MMAP == socket_config->send_backend)
+  {
+    /* Protocol 0 so the socket only transmits and never queues received frames */
+    sockfd = socket(AF_PACKET, SOCK_RAW, 0);
+  }
+  else if(SEND_ENGINE_BACKEND_AF_XDP == socket_config->send_backend)
+  {
+    /* Only one AF_XDP socket may be bound to the queue, it is opened up front and shared */
+    assert(socket_config->xdp_socket != nullptr);
+    sockfd = socket_config->xdp_socket->get_fd();
+  }
+  else if(SEND_ENGINE_BACKEND_DATAGRAM == socket_config->send_backend)
+  {
+    sockfd = socket(AF_INET, SOCK_DGRAM, IPPROTO_ICMP);
+  }
+  else if(SEND_ENGINE_BACKEND_IP_HDRINCL == socket_config->send_backend)
+  {
+    /* IPPROTO_RAW implies IP_HDRINCL and never receives, so replies are not queued on the send socket */
+    sockfd = socket(AF_INET, SOCK_RAW, IPPROTO_RAW);
+  }
+  else
+  {
+    sockfd = socket(AF_INET, SOCK_RAW, IPPROTO_ICMP);
+  }
+
+  if(sockfd == -1)
+  {
+    switch(errno)
     {
-      switch(errno)
+      case EPERM:
       {
-        case EPERM:
-        {
-          fprintf(stderr, "No permission to open socket for ping block dispatch.\n");
-          safe_exit(EXIT_STATUS_NO_PERMISSION);
-          break;
-        }
-        default:
-        {
-          fprintf(stderr, "Failed to open socket for ping block dispatch.  errno %u: %s\n", errno, strerror(errno));
-          safe_exit(1);
-          break;
-        }
+        fprintf(stderr, "No permission to open socket for ping block dispatch.\n");
+        safe_exit(EXIT_STATUS_NO_PERMISSION);
+        break;
+      }
+      case EACCES:
+      {
+        fprintf(stderr, "No permission to open ICMP datagram socket for ping block dispatch.  Group must be within net.ipv4.ping_group_range.\n");
+        safe_exit(EXIT_STATUS_NO_PERMISSION);
+        break;
+      }
+      default:
+      {
+        fprintf(stderr, "Failed to open socket for ping block dispatch.  errno %u: %s\n", errno, strerror(errno));
+        safe_exit(1);
+        break;
       }
     }
-    else
+  }
+  else if(SEND_ENGINE_BACKEND_PACKET_MMAP == socket_config->send_backend)
+  {
+    memset(&link_address, 0, sizeof(link_address));
+    link_address.sll_family   = AF_PACKET;
+    link_address.sll_protocol = htons(ETH_P_IP);
+    link_address.sll_ifindex  = (int) if_nametoindex(socket_config->send_interface);
+
+    if((0 == link_address.sll_ifindex) || (0 != bind(sockfd, (struct sockaddr*) &link_address, sizeof(link_address))))
+    {
+      fprintf(stderr, "Failed to bind socket for ping block dispatch to interface %s.  errno %u: %s\n", 
+        socket_config->send_interface, errno, strerror(errno));
+      safe_exit(1);
+    }
+  }
+  else if(SEND_ENGINE_BACKEND_DATAGRAM == socket_config->send_backend)
+  {
+    /* Bound port becomes the ICMP identifier of every echo request and selects which replies are delivered */
+    memset(&inet_address, 0, sizeof(inet_address));
+    inet_address.sin_family = AF_INET;
+    inet_address.sin_port   = htons(socket_config->identifier);
+
+    if(0 != bind(sockfd, (struct sockaddr*) &inet_address, sizeof(inet_address)))
+    {
+      fprintf(stderr, "Failed to bind ICMP datagram socket for ping block dispatch to identifier 0x%x.  errno %u: %s\n", 
+        socket_config->identifier, errno, strerror(errno));
+      safe_exit(1);
+    }
+    setsockopt(sockfd, IPPROTO_IP, IP_TTL, &socket_config->socket_ttl, sizeof(socket_config->socket_ttl));
+  }
+  else if(SEND_ENGINE_BACKEND_SOCKET == socket_config->send_backend)
+  {
+    setsockopt(sockfd, IPPROTO_IP, IP_TTL, &socket_config->socket_ttl, sizeof(socket_config->socket_ttl));
+  }
+
+  if( (sockfd != -1) && socket_config->tx_timestamps && !send_engine_backend_link_layer(socket_config->send_backend) )
+  {
+    /* Each sent packet is looped back to the error queue with the time the device transmitted it */
+    const int timestamping_flags = (SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE);
+    if(0 != setsockopt(sockfd, SOL_SOCKET, SO_TIMESTAMPING, &timestamping_flags, sizeof(timestamping_flags)))
+    {
+      fprintf(stderr, "Failed to enable TX timestamps for ping block dispatch socket.  errno %u: %s\n", errno, strerror(errno));
+    }
+
+    /* Looped packets are charged to the receive buffer, which a raw ICMP send socket would fill with replies it never reads */
+    if(SEND_ENGINE_BACKEND_SOCKET == socket_config->send_backend)
+    {
+      const struct icmp_filter filter_all = {.data = 0xFFFFFFFFU};
+      if(0 != setsockopt(sockfd, SOL_RAW, ICMP_FILTER, &filter_all, sizeof(filter_all)))
+      {
+        fprintf(stderr, "Failed to filter received ICMP on ping block dispatch socket.  errno %u: %s\n", errno, strerror(errno));
+      }
+    }
+  }
+
+  /* Larger send buffer absorbs bursts which would otherwise return EAGAIN or ENOBUFS */
+  if( (sockfd != -1) && (socket_config->socket_send_buffer > 0) &&
+      (0 != setsockopt(sockfd, SOL_SOCKET, SO_SNDBUF, &socket_config->socket_send_buffer, sizeof(socket_config->socket_send_buffer))) )
+  {
+    fprintf(stderr, "Failed to set send buffer of %u bytes for ping block dispatch socket.  errno %u: %s\n", 
+      socket_config->socket_send_buffer, errno, strerror(errno));
+  }
+
+  return sockfd;
+}
+
+void ping_block_c::init_send_engine_config(const ping_block_config_s *ping_block_config, send_engine_config_s *send_engine_config)
+{
+  assert(ping_block_config != nullptr);
+  assert(send_engine_config != nullptr);
+
+  memset(send_engine_config, 0, sizeof(*send_engine_config));
+  send_engine_config->batch_size    = ping_block_config->ping_batch_size;
+  send_engine_config->send_attempts = ping_block_config->send_attempts;
+  send_engine_config->backoff       = ping_block_config->send_backoff;
+  send_engine_config->backend       = ping_block_config->send_backend;
+  send_engine_config->ttl           = ping_block_config->socket_ttl;
+  send_engine_config->tx_timestamps = (ping_block_config->tx_timestamps && !send_engine_backend_link_layer(ping_block_config->send_backend));
+  send_engine_config->xdp_socket    = ping_block_config->xdp_socket;
+  memcpy(send_engine_config->gateway_mac, ping_block_config->gateway_mac, sizeof(send_engine_config->gateway_mac));
+}
+
+inline unsigned int ping_block_c::dispatch_flush(send_engine_c *send_engine, unsigned int shard, unsigned int *batch_index)
+{
+  unsigned int pings_sent;
+
+  if(config.verbose)
+  {
+    printf("Ping batch %u of shard %u.  Flushing %u pings.\n", *batch_index, shard, send_engine->get_queued());
+  }
+  if(config.rate_limiter != nullptr)
+  {
+    config.rate_limiter->acquire(send_engine->get_queued());
+  }
+  pings_sent = send_engine->flush();
+  (*batch_index)++;
+
+  return pings_sent;
+}
+
+uint_fast64_t ping_block_c::prefix_shard_offset(unsigned int shard, unsigned int shard_count) const
+{
+  const uint_fast64_t split_address = (uint_fast64_t)get_first_address() + 
+                                      ((((uint_fast64_t)get_address_count())*shard)/MAX(shard_count, 1U));
+  const uint_fast64_t slash_24_address = ((split_address >> PREFIX_SCHEDULER_SLASH_24_SHIFT) << PREFIX_SCHEDULER_SLASH_24_SHIFT);
+  uint_fast64_t       ret_val = get_address_count();
+
+  if(shard < shard_count)
+  {
+    ret_val = ((slash_24_address > get_first_address())?(slash_24_address-get_first_address()):0);
+  }
+
+  return ret_val;
+}
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+bool ping_block_c::next_scheduled_offset(prefix_scheduler_c *prefix_scheduler, send_engine_c *send_engine, unsigned int shard,
+                                         unsigned int *batch_index, unsigned int *pings_sent, uint_fast64_t *offset)
+{
+  prefix_scheduler_next_e next;
+  timestamp_ns_t          ready_time;
+  timestamp_ns_t          now;
+  struct timespec         wait_time;
+
+  while(PREFIX_SCHEDULER_WAIT == (next = prefix_scheduler->next(offset, &ready_time)))
+  {
+    if(!send_engine->is_empty())
+    {
+      *pings_sent += dispatch_flush(send_engine, shard, batch_index);
+    }
+
+    now = get_timestamp_ns();
+    if(ready_time > now)
+    {
+      wait_time.tv_sec  = (time_t)((ready_time-now)/TIMESTAMP_NS_PER_S);
+      wait_time.tv_nsec = (long)((ready_time-now)%TIMESTAMP_NS_PER_S);
+      nanosleep(&wait_time, nullptr);
+      prefix_scheduler->waited(ready_time-now);
+    }
+  }
+
+  return (PREFIX_SCHEDULER_READY == next);
+}
+
+void ping_block_c::init_echo_request_template(icmp_packet_template_s *icmp_packet_template) const
+{
+  icmp_packet_meta_s icmp_packet_meta;
+  pingo_payload_t    pingo_payload;
+
+  /* Payload is patched per echo request */
+  memset(&pingo_payload, 0, sizeof(pingo_payload));
+
+  memset(&icmp_packet_meta, 0, sizeof(icmp_packet_meta_s));
+  icmp_packet_meta.header.type = ICMP_TYPE_ECHO_REQUEST;
+  icmp_packet_meta.header.code = ICMP_CODE_ZERO;
+  icmp_packet_meta.header.rest_of_header.id_seq_num.identifier = config.identifier;
+  icmp_packet_meta.header_valid = true;
+  icmp_packet_meta.payload = (icmp_buffer_t*) &pingo_payload;
+  icmp_packet_meta.payload_size = sizeof(pingo_payload_t);
+  if(!init_icmp_packet_template(&icmp_packet_meta, icmp_packet_template))
+  {
+    fprintf(stderr, "Failed to build ICMP echo request template for ping block dispatch.\n");
+    safe_exit(1);
+  }
+}
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+inline void ping_block_c::queue_echo_request(send_engine_c *send_engine, const icmp_packet_template_s *icmp_packet_template, 
+                                             uint32_t dest_address, uint_fast64_t offset) const
+{
+  icmp_buffer_t   *packet = send_engine->get_slot_buffer();
+  const size_t     icmp_packet_size = write_icmp_packet_template(icmp_packet_template, packet, send_engine->get_slot_size());
+  pingo_payload_t  pingo_payload;
+  probe_cookie_t   cookie;
+  uint16_t         sequence_number;
+
+  /* Only patch fields which differ from the template, checksum is updated incrementally */
+  pingo_payload.request_time = get_timestamp_us32();
+  cookie                     = probe_cookie(&config.cookie_key, dest_address, pingo_payload.request_time);
+  pingo_payload.cookie       = (uint32_t)(cookie >> 32);
+  sequence_number            = htons((uint16_t)cookie);
+  patch_icmp_packet(packet, ICMP_SEQUENCE_NUMBER_OFFSET_BYTES, &sequence_number, sizeof(sequence_number));
+  patch_icmp_packet(packet, ICMP_PAYLOAD_OFFSET_BYTES, &pingo_payload, sizeof(pingo_payload));
+
+  send_engine->queue(dest_address, icmp_packet_size, (uint16_t)offset);
+}
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+bool ping_block_c::dispatch_shard(int sockfd, unsigned int shard, unsigned int shard_count)
+{
+  bool                 ret_val = false;
+  send_engine_config_s send_engine_config;
+
+  if(sockfd != -1)
+  {
+    init_send_engine_config(&config, &send_engine_config);
+    send_engine_c send_engine(sockfd, &send_engine_config);
+    ret_val = dispatch_shard(&send_engine, shard, shard_count);
+  }
+  else
+  {
+    ret_val = dispatch_shard(nullptr, shard, shard_count);
+  }
+
+  return ret_val;
+}
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+bool ping_block_c::dispatch_shard(send_engine_c *send_engine, unsigned int shard, unsigned int shard_count)
+{
+  bool ret_val = false;
+
+  unsigned int           batch_index = 0;
+  icmp_packet_template_s icmp_packet_template;
+  unsigned int           pings_sent = 0;
+  struct timespec        temp_time;
+  char                   ip_string_buffer[IP_STRING_SIZE];
+  send_engine_stats_s    send_stats_start;
+  send_engine_stats_s    send_stats_done;
+  bool                   shard_valid;
+  prefix_scheduler_c    *prefix_scheduler = nullptr;
+  prefix_scheduler_config_s prefix_caps;
+  prefix_scheduler_stats_s  prefix_stats;
+
+  uint_fast64_t          offset;
+  uint32_t               dest_address;
+  uint32_t               skipped_last;
+  ping_block_skip_reason_e skip_reason;
+
+  /* Every block has its own order, derived from the seed so a block is always dispatched in the same order.
+      Shards split the positions of the order into contiguous slices */
+  scan_order_c           scan_order(config.scan_order, get_address_count(), get_scan_seed());
+  const scan_order_position_t shard_first_position = (scan_order.get_positions()*shard)/MAX(shard_count, 1U);
+  const scan_order_position_t shard_last_position  = (scan_order.get_positions()*(shard+1))/MAX(shard_count, 1U);
+
+  get_time(&temp_time);
+
+  lock();
+  shard_valid = ((shard < shard_count) && 
+                 ((0 == shards_started) || ((shard_count == dispatch_shard_count) && !shard_started[shard])));
+  if(shard_valid)
+  {
+    if(0 == shards_started)
+    {
+      dispatch_started           = true;
+      dispatch_start_time        = temp_time;
+      dispatch_shard_count       = shard_count;
+      dispatch_stats.target_rate = ((config.rate_limiter != nullptr)?config.rate_limiter->get_rate():0);
+      shard_started.assign(shard_count, false);
+    }
+    shard_started[shard] = true;
+    shards_started++;
+  }
+  unlock();
+
+  if(shard_valid)
+  {
+    if(send_engine != nullptr)
     {
-      setsockopt(sockfd, IPPROTO_IP, IP_TTL, &config.socket_ttl, sizeof(config.socket_ttl));
+      assert(send_engine->is_empty());
+
+      init_echo_request_template(&icmp_packet_template);
+
+      send_engine->set_drop_cb(dispatch_drop_cb, this);
+      send_engine->set_tx_timestamp_cb(dispatch_tx_timestamp_cb, this);
+      send_stats_start = send_engine->get_stats();
 
-      for(batch_index = 0; dest_address < get_last_address(); batch_index++)
+      if(is_prefix_capped())
       {
-        if(config.verbose)
+        /* Shards schedule their own slice of offsets.  Slices start on /24 boundaries so each /24 is capped by one shard alone.
+            A /16 may span every shard so its cap is split between them */
+        prefix_caps = config.prefix_caps;
+        if(prefix_caps.max_rate_16 > 0)
         {
-          ip_string(dest_address, ip_string_buffer, sizeof(ip_string_buffer));
-          printf("Ping batch %u.  %u IPs starting at IP %s\n",
-                batch_index, config.ping_batch_size, ip_string_buffer);
+          prefix_caps.max_rate_16 = MAX(1U, (prefix_caps.max_rate_16/MAX(shard_count, 1U)));
         }
+        prefix_scheduler = new prefix_scheduler_c(get_first_address(), 
+                                                  prefix_shard_offset(shard, shard_count),
+                                                  prefix_shard_offset((shard+1), shard_count),
+                                                  &prefix_caps);
+      }
+
+      scan_order.seek(shard_first_position);
+      while((prefix_scheduler != nullptr)?
+            next_scheduled_offset(prefix_scheduler, send_engine, shard, &batch_index, &pings_sent, &offset):
+            scan_order.next(&offset, shard_last_position))
+      {
+        dest_address = (uint32_t)(get_first_address()+offset);
 
-        for(unsigned int i = 0; i < config.ping_batch_size; i++)
+        skip_reason = skip_ip_address(dest_address, &skipped_last);
+        if(PING_BLOCK_IP_SKIP_REASON_NOT_SKIPPED == skip_reason)
         {
-          if(!exclude_ip_address(dest_address))
-          {
-            remaining_attempts = config.send_attempts;
-            send_sockaddr.sin_addr.s_addr = htonl(dest_address);
-            icmp_packet_meta.header.checksum = 0;
-            icmp_packet_meta.header.rest_of_header.id_seq_num.sequence_number = 
-              (config.fixed_sequence_number?config.sequence_number:packet_id);
-            pingo_payload.dest_address = dest_address;
-            get_time(&pingo_payload.request_time);
-
-            size_t icmp_packet_size = encode_icmp_packet(&icmp_packet_meta, (icmp_buffer_t*) buffer, sizeof(buffer));
-
-            while((remaining_attempts > 0) &&
-                  (icmp_packet_size != (size_t)sendto(sockfd, buffer, icmp_packet_size, 0, (sockaddr*)&send_sockaddr, sizeof(send_sockaddr))))
-            {
-              ip_string(dest_address, ip_string_buffer, sizeof(ip_string_buffer));
-              fprintf(stderr, "Failed to send ping for IP %s to socket.  errno %u: %s\n", ip_string_buffer, errno, strerror(errno));
-              remaining_attempts--;
-              if(0 == remaining_attempts)
-              {
-                fprintf(stderr, "Aborting further attempts to send ping.\n");
-                lock();
-                assert((dest_address >= get_first_address()) && ((dest_address-get_first_address()) < get_address_count()));
-                entry[(dest_address-get_first_address())] = 
-                  {
-                    .reply_valid = false,
-                    .ping_time   = PINGO_BLOCK_PING_TIME_NO_RESPONSE,
-                    .skip_reason = PING_BLOCK_IP_SKIP_REASON_SOCKET_ERROR,
-                    .skip_errno  = errno,
-                  };
-                unlock();
-              }
-              else
-              {
-                fprintf(stderr, "Reattempting to send ping in 1s.  %u attempts remaining\n", remaining_attempts);
-                sleep(1);
-              }
-            }
-          }
-          else
-          {
-            lock();
-            assert((dest_address >= get_first_address()) && ((dest_address-get_first_address()) < get_address_count()));
-            entry[(dest_address-get_first_address())] = 
-              {
-                .reply_valid = false,
-                .ping_time   = PINGO_BLOCK_PING_TIME_NO_RESPONSE,
-                .skip_reason = PING_BLOCK_IP_SKIP_REASON_EXCLUDE_LIST,
-                .skip_errno  = -1,
-              };
-            unlock();
-          }
-          packet_id++;
-          dest_address++;
-          if(dest_address >= get_last_address())
+          queue_echo_request(send_engine, &icmp_packet_template, dest_address, offset);
+          if(prefix_scheduler != nullptr)
           {
-            break;
+            prefix_scheduler->sent(offset);
           }
         }
-        if(dest_address < get_last_address())
+        else if((SCAN_ORDER_SEQUENTIAL == config.scan_order) && (nullptr == prefix_scheduler))
         {
-          nanosleep(&config.ping_batch_cooldown,nullptr);
+          /* Positions are offsets in sequential order, jump straight past the skipped run within this shard */
+          skipped_last = (uint32_t)(get_first_address()+MIN((uint_fast64_t)(skipped_last-get_first_address()), (shard_last_position-1)));
+          mark_skipped(dest_address, skipped_last, skip_reason);
+          scan_order.seek(((uint_fast64_t)skipped_last-get_first_address())+1);
+        }
+        else
+        {
+          mark_skipped(dest_address, dest_address, skip_reason);
+        }
+
+        if(send_engine->is_full())
+        {
+          pings_sent += dispatch_flush(send_engine, shard, &batch_index);
+
+          if(config.rate_limiter == nullptr)
+          {
+            nanosleep(&config.ping_batch_cooldown,nullptr);
+          }
         }
       }
-      get_time(&temp_time);
-      ret_val = true;
-        
-      if(0 != close(sockfd))
+      if(!send_engine->is_empty())
       {
-        ip_string(get_first_address(), ip_string_buffer, sizeof(ip_string_buffer));
-        fprintf(stderr, "Failed to close socket for ping block.  First address %s address count %u.  errno %u: %s\n", 
-          ip_string_buffer, get_address_count(), errno, strerror(errno));
-        ret_val = false;
+        pings_sent += dispatch_flush(send_engine, shard, &batch_index);
       }
 
+      /* Timestamps of the last batch may only have been queued as flush() returned */
+      send_engine->read_tx_timestamps();
+
+      /* Engine totals span every ping block it sent, only this shard's share is credited to the block */
+      send_stats_done = send_engine->get_stats();
+      send_engine->set_drop_cb(nullptr, nullptr);
+      send_engine->set_tx_timestamp_cb(nullptr, nullptr);
       lock();
+      dispatch_stats.pings_sent   += pings_sent;
+      dispatch_stats.send_retries += (unsigned int)(send_stats_done.retries - send_stats_start.retries);
+      dispatch_stats.send_drops   += (unsigned int)(send_stats_done.drops   - send_stats_start.drops);
+      if(prefix_scheduler != nullptr)
+      {
+        prefix_stats = prefix_scheduler->get_stats();
+        dispatch_stats.prefix_deferred_24 += prefix_stats.deferred_24;
+        dispatch_stats.prefix_deferred_16 += prefix_stats.deferred_16;
+        dispatch_stats.prefix_waits       += prefix_stats.waits;
+        dispatch_stats.prefix_wait_ms     += NANOSEC_TO_MS(prefix_stats.wait_ns);
+      }
+      unlock();
+
+      delete prefix_scheduler;
+      ret_val = true;
+    }
+
+    /* Last shard to finish completes the ping block */
+    get_time(&temp_time);
+    lock();
+    shards_done++;
+    if(shards_done == dispatch_shard_count)
+    {
       dispatch_done_time = temp_time;
       diff_timespec(&dispatch_done_time, &dispatch_start_time, &dispatch_time);
       fully_dispatched = true;
       assert(0==pthread_cond_broadcast(&dispatch_done_cond));
-      unlock();
-  
+
       if(config.verbose)
       {
         ip_string(get_first_address(), ip_string_buffer, sizeof(ip_string_buffer));
@@ -322,15 +699,157 @@ bool ping_block_c::dispatch()
           ip_string_buffer, get_address_count());
       }
     }
+    unlock();
+  }
+  else
+  {
+    ip_string(get_first_address(), ip_string_buffer, sizeof(ip_string_buffer));
+    fprintf(stderr, "Dispatch for ping block starting at IP %s already started or invalid shard %u/%u.\n", 
+      ip_string_buffer, shard, shard_count);
+  }
+
+  return ret_val;
+}
+
+bool ping_block_c::dispatch()
+{
+  bool ret_val = false;
+  char ip_string_buffer[IP_STRING_SIZE];
+  int  sockfd;
+
+  if(!is_dispatch_started())
+  {
+    sockfd = open_socket(&config);
+    ret_val = dispatch_shard(sockfd, 0, 1);
+
+    if((sockfd != -1) && (0 != close(sockfd)))
+    {
+      ip_string(get_first_address(), ip_string_buffer, sizeof(ip_string_buffer));
+      fprintf(stderr, "Failed to close socket for ping block.  First address %s address count %u.  errno %u: %s\n", 
+        ip_string_buffer, get_address_count(), errno, strerror(errno));
+      ret_val = false;
+    }
   }
   else
   {
-    ip_string(dest_address, ip_string_buffer, sizeof(ip_string_buffer));
+    ip_string(get_first_address(), ip_string_buffer, sizeof(ip_string_buffer));
     fprintf(stderr, "Dispatch for ping block starting at IP %s already started.\n", ip_string_buffer);
   }
 
   return ret_val;
 }
+bool ping_block_c::dispatch_retry(send_engine_c *send_engine)
+{
+  bool                   ret_val = false;
+  bool                   retry_valid;
+  bool                   retry_address;
+  unsigned int           batch_index = 0;
+  unsigned int           pings_sent = 0;
+  icmp_packet_template_s icmp_packet_template;
+  send_engine_stats_s    send_stats_start;
+  send_engine_stats_s    send_stats_done;
+  uint_fast64_t          offset;
+  char                   ip_string_buffer[IP_STRING_SIZE];
+  scan_order_c           scan_order(config.scan_order, get_address_count(), get_scan_seed());
+
+  lock();
+  retry_valid = (fully_dispatched && !retry_started);
+  retry_started = (retry_started || retry_valid);
+  unlock();
+
+  if(retry_valid)
+  {
+    if(send_engine != nullptr)
+    {
+      assert(send_engine->is_empty());
+
+      init_echo_request_template(&icmp_packet_template);
+
+      /* A failed retry leaves the address as not replied instead of skipped */
+      send_engine->set_drop_cb(nullptr, nullptr);
+      send_engine->set_tx_timestamp_cb(dispatch_tx_timestamp_cb, this);
+      send_stats_start = send_engine->get_stats();
+
+      while(scan_order.next(&offset, scan_order.get_positions()))
+      {
+        lock();
+        retry_address = ((!entry[offset].reply_valid) && (PING_BLOCK_IP_SKIP_REASON_NOT_SKIPPED == entry[offset].skip_reason));
+        if(retry_address)
+        {
+          /* Send delay of the retry replaces the first echo request's */
+          entry[offset].retried       = true;
+          entry[offset].send_delay_us = 0;
+        }
+        unlock();
+
+        if(retry_address)
+        {
+          queue_echo_request(send_engine, &icmp_packet_template, (uint32_t)(get_first_address()+offset), offset);
+        }
+
+        if(send_engine->is_full())
+        {
+          pings_sent += dispatch_flush(send_engine, 0, &batch_index);
+
+          if(config.rate_limiter == nullptr)
+          {
+            nanosleep(&config.ping_batch_cooldown,nullptr);
+          }
+        }
+      }
+      if(!send_engine->is_empty())
+      {
+        pings_sent += dispatch_flush(send_engine, 0, &batch_index);
+      }
+      send_engine->read_tx_timestamps();
+
+      send_stats_done = send_engine->get_stats();
+      send_engine->set_tx_timestamp_cb(nullptr, nullptr);
+      lock();
+      dispatch_stats.retry_pings_sent += pings_sent;
+      dispatch_stats.retry_send_drops += (unsigned int)(send_stats_done.drops - send_stats_start.drops);
+      unlock();
+
+      ret_val = true;
+    }
+
+    lock();
+    retry_done = true;
+    assert(0==pthread_cond_broadcast(&dispatch_done_cond));
+    unlock();
+  }
+  else
+  {
+    ip_string(get_first_address(), ip_string_buffer, sizeof(ip_string_buffer));
+    fprintf(stderr, "Retry for ping block starting at IP %s already started or ping block not fully dispatched.\n", ip_string_buffer);
+  }
+
+  return ret_val;
+}
+
+bool ping_block_c::is_retry_started()
+{
+  bool ret_val = false;
+
+  lock();
+  ret_val = retry_started;
+  unlock();
+
+  return ret_val;
+}
+
+void ping_block_c::wait_retry_done()
+{
+  lock();
+
+  while(is_retry_enabled() && !retry_done)
+  {
+    assert(0==pthread_cond_wait(&dispatch_done_cond, &mutex));
+  }
+
+  unlock();
+}
+
 bool ping_block_c::is_dispatch_started()
 {
   bool ret_val = false;
@@ -413,13 +932,24 @@ void ping_block_c::wait_dispatch_done()
   unlock();
 }
 
+ping_block_dispatch_stats_s ping_block_c::get_dispatch_stats()
+{
+  ping_block_dispatch_stats_s ret_val;
+
+  lock();
+  ret_val = dispatch_stats;
+  unlock();
+
+  return ret_val;
+}
+
 ping_block_stats_s ping_block_c::get_stats()
 {
   ping_block_stats_s stats;
 
   memset(&stats, 0, sizeof(stats));
   stats.min_reply_time  = PINGO_BLOCK_PING_TIME_NO_RESPONSE;
-  stats.mean_reply_time = PINGO_BLOCK_PING_TIME_NO_RESPONSE;
+  /* Mean is summed from 0 and only set to no response once there were no replies */
   stats.max_reply_time  = PINGO_BLOCK_PING_TIME_NO_RESPONSE;
 
   lock();
@@ -429,6 +959,10 @@ ping_block_stats_s ping_block_c::get_stats()
     if(entry[i].reply_valid)
     {
       stats.valid_replies++;
+      if(entry[i].retried)
+      {
+        stats.retried_replies++;
+      }
 
       if((entry[i].ping_time < stats.min_reply_time) || (PINGO_BLOCK_PING_TIME_NO_RESPONSE == stats.min_reply_time))
       {
@@ -461,18 +995,63 @@ ping_block_stats_s ping_block_c::get_stats()
   return stats;
 }
 
-inline bool ping_block_c::exclude_ip_address(const uint32_t check_ip)
+inline ping_block_skip_reason_e ping_block_c::skip_ip_address(const uint32_t check_ip, uint32_t *run_last)
 {
-  bool ret_val = false;
+  ping_block_skip_reason_e ret_val    = PING_BLOCK_IP_SKIP_REASON_NOT_SKIPPED;
+  uint32_t                 range_last = check_ip;
+  size_t                   range_index;
 
-  for(ping_block_excluded_ip_list_t::iterator it = excluded_ip_list.begin(); it != excluded_ip_list.end(); it++)
+  if(config.include_set != nullptr)
   {
-    if((check_ip & it->subnet_mask) == it->ip)
+    /* Not included up to the start of the next included range */
+    range_index = config.include_set->lower_bound(check_ip);
+    if(range_index >= config.include_set->get_range_count())
     {
-      ret_val = true;
-      break;
+      ret_val    = PING_BLOCK_IP_SKIP_REASON_NOT_INCLUDED;
+      range_last = MAX_IP;
     }
+    else if(config.include_set->get_range(range_index).first > check_ip)
+    {
+      ret_val    = PING_BLOCK_IP_SKIP_REASON_NOT_INCLUDED;
+      range_last = (config.include_set->get_range(range_index).first-1);
+    }
+  }
+
+  if( (PING_BLOCK_IP_SKIP_REASON_NOT_SKIPPED == ret_val) && config.skip_reserved &&
+      reserved_address(check_ip, &range_last) )
+  {
+    ret_val = PING_BLOCK_IP_SKIP_REASON_RESERVED;
   }
 
+  if( (PING_BLOCK_IP_SKIP_REASON_NOT_SKIPPED == ret_val) && exclude_set_overlaps &&
+      config.exclude_set->contains(check_ip, &range_last) )
+  {
+    ret_val = PING_BLOCK_IP_SKIP_REASON_EXCLUDE_LIST;
+  }
+
+  *run_last = MIN(range_last, (get_first_address()+(get_address_count()-1)));
+
   return ret_val;
-}
\ No newline at end of file
+}
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+void ping_block_c::mark_skipped(uint32_t first_skipped, uint32_t last_skipped, ping_block_skip_reason_e skip_reason)
+{
+  lock();
+  assert((first_skipped >= get_first_address()) && (first_skipped <= last_skipped) && 
+         ((last_skipped-get_first_address()) < get_address_count()));
+  for(uint32_t i = (first_skipped-get_first_address()); i <= (last_skipped-get_first_address()); i++)
+  {
+    entry[i] = 
+      {
+        .reply_valid = false,
+        .retried     = false,
+        .ping_time   = PINGO_BLOCK_PING_TIME_NO_RESPONSE,
+        .ping_time_us = PINGO_BLOCK_PING_TIME_NO_RESPONSE,
+        .send_delay_us = 0,
+        .skip_reason = skip_reason,
+        .skip_errno  = -1,
+      };
+  }
+  unlock();
+}
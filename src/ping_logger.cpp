@@ -24,6 +24,70 @@ inline void ping_logger_c::unlock_ping_block()
   assert(0 == pthread_mutex_unlock(&ping_block_mutex));
 }
 
+void ping_logger_c::set_ping_block_window(const ping_block_window_s *window)
+{
+  assert(window != nullptr);
+
+  lock_ping_block();
+
+  ping_block_window = *window;
+  pthread_cond_broadcast(&ping_block_window_cond);
+
+  unlock_ping_block();
+}
+
+/* Caller must hold the ping block lock */
+inline bool ping_logger_c::ping_block_window_fits(size_t bytes) const
+{
+  return ( (0 == ping_block_window_stats.ping_blocks) ||
+           ( ((0 == ping_block_window.max_ping_blocks) || (ping_block_window_stats.ping_blocks < ping_block_window.max_ping_blocks)) &&
+             ((0 == ping_block_window.max_bytes)       || ((ping_block_window_stats.bytes + bytes) <= ping_block_window.max_bytes)) ) );
+}
+
+void ping_logger_c::wait_for_ping_block_window(size_t bytes)
+{
+  struct timespec wait_start_time;
+  struct timespec wait_done_time;
+  struct timespec wait_time;
+
+  lock_ping_block();
+
+  if(!ping_block_window_fits(bytes))
+  {
+    get_time(&wait_start_time);
+    do
+    {
+      assert(0==pthread_cond_wait(&ping_block_window_cond, &ping_block_mutex));
+    } while(!ping_block_window_fits(bytes));
+    get_time(&wait_done_time);
+
+    diff_timespec(&wait_done_time, &wait_start_time, &wait_time);
+    ping_block_window_stats.full_waits++;
+    ping_block_window_stats.full_wait_ms += TIMESPEC_TO_MS(wait_time);
+  }
+
+  /* Counted from here so ping blocks built ahead of their push hold their place in the window */
+  ping_block_window_stats.ping_blocks++;
+  ping_block_window_stats.bytes           += bytes;
+  ping_block_window_stats.peak_ping_blocks = MAX(ping_block_window_stats.peak_ping_blocks, ping_block_window_stats.ping_blocks);
+  ping_block_window_stats.peak_bytes       = MAX(ping_block_window_stats.peak_bytes, ping_block_window_stats.bytes);
+
+  unlock_ping_block();
+}
+
+ping_block_window_stats_s ping_logger_c::get_ping_block_window_stats()
+{
+  ping_block_window_stats_s ret_val;
+
+  lock_ping_block();
+
+  ret_val = ping_block_window_stats;
+
+  unlock_ping_block();
+
+  return ret_val;
+}
+
 /* Pushes a ping block into the logger database.  Pusher's is responsible to init and dispatch pushed ping block */
 bool ping_logger_c::push_ping_block(ping_block_c* ping_block)
 {
@@ -51,6 +115,9 @@ ping_block_c* ping_logger_c::pop_ping_block()
   {
     ret_ptr = ping_block_queue.front();
     ping_block_queue.pop_front();
+    ping_block_window_stats.ping_blocks--;
+    ping_block_window_stats.bytes -= ret_ptr->get_memory_size();
+    pthread_cond_broadcast(&ping_block_window_cond);
   }
 
   unlock_ping_block();
@@ -89,6 +156,32 @@ void ping_logger_c::wait_for_ping_block()
   unlock_ping_block();
 }
 
+ping_block_c* ping_logger_c::wait_for_ping_block_retry()
+{
+  ping_block_c* ret_ptr = nullptr;
+
+  lock_ping_block();
+
+  while(nullptr == ret_ptr)
+  {
+    for(ping_block_queue_t::iterator it = ping_block_queue.begin(); (nullptr == ret_ptr) && (it != ping_block_queue.end()); it++)
+    {
+      if(!(*it)->is_retry_started())
+      {
+        ret_ptr = *it;
+      }
+    }
+    if(nullptr == ret_ptr)
+    {
+      assert(0==pthread_cond_wait(&ping_block_ready_cond, &ping_block_mutex));
+    }
+  }
+
+  unlock_ping_block();
+
+  return ret_ptr;
+}
+
 unsigned int ping_logger_c::get_num_ping_blocks()
 {
   unsigned int ret_val = 0;
@@ -117,6 +210,25 @@ bool ping_logger_c::push_log_entry(ping_log_entry_s log_entry)
   return ret_val;
 }
 
+bool ping_logger_c::push_log_entries(const ping_log_entry_s *log_entries, size_t count)
+{
+  bool ret_val = true;
+
+  assert((log_entries != nullptr) || (0 == count));
+
+  if(count > 0)
+  {
+    lock_log_entry();
+
+    log_entry_queue.insert(log_entry_queue.end(), log_entries, (log_entries+count));
+    pthread_cond_broadcast(&log_entry_ready_cond);
+
+    unlock_log_entry();
+  }
+
+  return ret_val;
+}
+
 ping_log_entry_s ping_logger_c::pop_log_entry()
 {
   ping_log_entry_s ret_val;
@@ -158,7 +270,7 @@ void ping_logger_c::process_echo_reply_log_entry(ping_log_entry_s *log_entry)
       (PING_LOG_ENTRY_ECHO_REPLY==log_entry->header.type) && 
       (timespec_valid(&log_entry->data.echo_reply.reply_delay)))
   {
-    reply_delay = (uint_fast32_t) TIMESPEC_TO_MS(log_entry->data.echo_reply.reply_delay);
+    reply_delay = (uint_fast32_t) TIMESPEC_TO_US(log_entry->data.echo_reply.reply_delay);
 
     lock_ping_block();
     if(!ping_block_queue.empty())
@@ -166,7 +278,7 @@ void ping_logger_c::process_echo_reply_log_entry(ping_log_entry_s *log_entry)
       it = ping_block_queue.begin();
       while(it != ping_block_queue.end())
       {
-        if((*it)->log_ping_time(log_entry->data.echo_reply.payload.dest_address, reply_delay))
+        if((*it)->log_ping_time(log_entry->data.echo_reply.dest_address, reply_delay))
         {
           break;
         }
@@ -179,8 +291,8 @@ void ping_logger_c::process_echo_reply_log_entry(ping_log_entry_s *log_entry)
     if(late_reply)
     {
       char ip_string_buffer[IP_STRING_SIZE];
-      ip_string(log_entry->data.echo_reply.payload.dest_address, ip_string_buffer, sizeof(ip_string_buffer));
-      fprintf(stderr, "Late echo reply, ping block already released.  Dest address %s, reply_delay %lu\n",
+      ip_string(log_entry->data.echo_reply.dest_address, ip_string_buffer, sizeof(ip_string_buffer));
+      fprintf(stderr, "Late echo reply, ping block already released.  Dest address %s, reply_delay %luus\n",
         ip_string_buffer, reply_delay);
     }
   }
@@ -207,4 +319,33 @@ void ping_logger_c::process_log_entry()
       break;
     }
   }
-}
\ No newline at end of file
+}
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+bool ping_logger_c::log_tx_timestamp(uint32_t dest_address, const icmp_buffer_t *icmp_packet, size_t icmp_packet_size, timestamp_ns_t tx_time)
+{
+  bool ret_val = false;
+
+  lock_ping_block();
+  for(ping_block_queue_t::iterator it = ping_block_queue.begin(); it != ping_block_queue.end(); it++)
+  {
+    if((*it)->log_tx_timestamp(dest_address, icmp_packet, icmp_packet_size, tx_time))
+    {
+      ret_val = true;
+      break;
+    }
+  }
+  unlock_ping_block();
+
+  return ret_val;
+}
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+void ping_logger_c::log_tx_timestamp_cb(uint32_t dest_address, const icmp_buffer_t *icmp_packet, size_t icmp_packet_size, 
+                                        timestamp_ns_t tx_time, void * user_data_ptr)
+{
+  ping_logger_c *ping_logger = (ping_logger_c*) user_data_ptr;
+
+  assert(ping_logger != nullptr);
+
+  ping_logger->log_tx_timestamp(dest_address, icmp_packet, icmp_packet_size, tx_time);
+}
@@ -4,18 +4,29 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <deque>
 #include <netinet/in.h>
 #include <pthread.h>
+#include <sched.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <unistd.h>
+#include <vector>
 
+#include "address_list.hpp"
+#include "address_set.hpp"
 #include "file.hpp"
 #include "icmp.hpp"
 #include "ipv4.hpp"
 #include "ping_block.hpp"
 #include "ping_logger.hpp"
 #include "pingo.hpp"
+#include "probe_cookie.hpp"
+#include "rate_controller.hpp"
+#include "rate_limiter.hpp"
+#include "recv_engine.hpp"
+#include "timestamp.hpp"
+#include "xdp_socket.hpp"
 
 #include "hilbert.hpp"
 #include "image.hpp"
@@ -190,6 +201,8 @@ typedef struct
   pingo_writer_arguments_s  args;
   ping_logger_c            *ping_logger;
   file_manager_c           *file_manager;
+  /* Fed the reply yield of every soaked ping block.  nullptr if the send rate is not adapted */
+  rate_controller_c        *rate_controller;
 } writer_thread_args_s;
 
 void *writer_thread_f(void* arg)
@@ -203,6 +216,9 @@ void *writer_thread_f(void* arg)
   struct timespec remaining_soak_time, time_since_dispatch, dispatch_time;
   char ip_string_buffer[IP_STRING_SIZE];
   ping_block_stats_s ping_block_stats;
+  ping_block_dispatch_stats_s dispatch_stats;
+  ping_block_window_stats_s window_stats;
+  uint_fast64_t dispatch_ns;
 
   assert(writer_thread_args);
   ping_logger = writer_thread_args->ping_logger;
@@ -212,7 +228,7 @@ void *writer_thread_f(void* arg)
 
   soak_time = 
     {
-      .tv_sec = ((PINGO_ARGUMENT_VALID == writer_thread_args->args.soak_timeout_status)?writer_thread_args->args.soak_timeout:60), 
+      .tv_sec = ((PINGO_ARGUMENT_VALID == writer_thread_args->args.soak_timeout_status)?writer_thread_args->args.soak_timeout:PINGO_DEFAULT_SOAK_TIMEOUT), 
       .tv_nsec = 0
     };
 
@@ -220,19 +236,52 @@ void *writer_thread_f(void* arg)
   {
     printf("Waiting for ping block.\n");
     ping_logger->wait_for_ping_block();
-    printf("%u ping blocks registered.\n", ping_logger->get_num_ping_blocks());
+    window_stats = ping_logger->get_ping_block_window_stats();
+    printf("%u ping blocks held in %lu KiB (peak %u ping blocks in %lu KiB).\n", 
+      window_stats.ping_blocks, (window_stats.bytes/1024), window_stats.peak_ping_blocks, (window_stats.peak_bytes/1024));
+    if(window_stats.full_waits > 0)
+    {
+      printf("Sending waited %lu times for %lu.%03lus in total for the ping block window to drain.\n", 
+        window_stats.full_waits, MS_TO_SECONDS(window_stats.full_wait_ms), (window_stats.full_wait_ms%1000));
+    }
     ping_block = ping_logger->peek_ping_block();
     ping_block->wait_dispatch_done();
     dispatch_time = ping_block->get_dispatch_time();
+    dispatch_stats = ping_block->get_dispatch_stats();
     ip_string(ping_block->get_first_address(), ip_string_buffer, sizeof(ip_string_buffer));
     printf("Ping block %u starting at %s with %u IPs dispatched in %lu.%03lus.\n", 
       ping_block_counter, ip_string_buffer, ping_block->get_address_count(), dispatch_time.tv_sec, NANOSEC_TO_MS(dispatch_time.tv_nsec));
+    dispatch_ns = (dispatch_time.tv_sec*RATE_LIMITER_NS_PER_SECOND) + dispatch_time.tv_nsec;
+    if(dispatch_ns > 0)
+    {
+      const uint_fast64_t achieved_rate = (((uint_fast64_t)dispatch_stats.pings_sent)*RATE_LIMITER_NS_PER_SECOND)/dispatch_ns;
+      if(dispatch_stats.target_rate > 0)
+      {
+        printf("%u pings sent at %lu pings per second (target %lu, %lu%%).\n", 
+          dispatch_stats.pings_sent, achieved_rate, dispatch_stats.target_rate, (achieved_rate*PERCENT_100)/dispatch_stats.target_rate);
+      }
+      else
+      {
+        printf("%u pings sent at %lu pings per second.\n", dispatch_stats.pings_sent, achieved_rate);
+      }
+    }
+    if((dispatch_stats.send_retries > 0) || (dispatch_stats.send_drops > 0))
+    {
+      printf("%u sends retried after socket backpressure, %u pings dropped.\n", dispatch_stats.send_retries, dispatch_stats.send_drops);
+    }
+    if((dispatch_stats.prefix_deferred_24 > 0) || (dispatch_stats.prefix_deferred_16 > 0))
+    {
+      printf("Prefix caps deferred %lu pings by /24 and %lu by /16, waited %lu times for %lu.%03lus.\n", 
+        dispatch_stats.prefix_deferred_24, dispatch_stats.prefix_deferred_16, dispatch_stats.prefix_waits,
+        dispatch_stats.prefix_wait_ms/1000, dispatch_stats.prefix_wait_ms%1000);
+    }
     time_since_dispatch = ping_block->time_since_dispatch();
     if(diff_timespec(&soak_time, &time_since_dispatch, &remaining_soak_time))
     {
       printf("Soaking for %lu.%03lu more seconds.\n", remaining_soak_time.tv_sec, NANOSEC_TO_MS(remaining_soak_time.tv_nsec));
       nanosleep(&remaining_soak_time, nullptr);
     }
+    ping_block->wait_retry_done();
     assert(ping_block == ping_logger->pop_ping_block());
     time_since_dispatch = ping_block->time_since_dispatch();
     ping_block_stats = ping_block->get_stats();
@@ -240,6 +289,22 @@ void *writer_thread_f(void* arg)
       time_since_dispatch.tv_sec, NANOSEC_TO_MS(time_since_dispatch.tv_nsec),
       ping_block_stats.valid_replies, ping_block->get_address_count(), (ping_block_stats.valid_replies*100)/ping_block->get_address_count(),
       ping_block_stats.min_reply_time, ping_block_stats.mean_reply_time, ping_block_stats.max_reply_time, ping_block_stats.skipped_pings);
+    dispatch_stats = ping_block->get_dispatch_stats();
+    if((dispatch_stats.retry_pings_sent > 0) || (dispatch_stats.retry_send_drops > 0))
+    {
+      printf("Retried %u pings to addresses which had not replied, %u replied.  %u retries dropped.\n", 
+        dispatch_stats.retry_pings_sent, ping_block_stats.retried_replies, dispatch_stats.retry_send_drops);
+    }
+    if(writer_thread_args->rate_controller != nullptr)
+    {
+      const rate_controller_action_e rate_action = 
+        writer_thread_args->rate_controller->yield_feedback((ping_block->get_address_count()-ping_block_stats.skipped_pings), ping_block_stats.valid_replies);
+      if(RATE_CONTROLLER_ACTION_DECREASE_YIELD == rate_action)
+      {
+        printf("Send rate %s to %lu pings per second.\n", 
+          rate_controller_c::action_string(rate_action), writer_thread_args->rate_controller->get_rate());
+      }
+    }
     printf("Writing ping block to file\n");
     file_manager->write_ping_block_to_file(ping_block);
     delete ping_block;
@@ -255,9 +320,317 @@ typedef struct
   pingo_ping_block_arguments_s  ping_block_args;
   ping_logger_c                *ping_logger;
   uint32_t                      ping_block_first_address;
-  ping_block_excluded_ip_list_t *excluded_ip_list;
+  const address_set_c          *exclude_set;
+  /* Adapts the rate limiter's rate after every ping block.  nullptr for a fixed rate */
+  rate_controller_c            *rate_controller;
+  /* Only addresses in this set are pinged.  nullptr to ping every address */
+  const address_set_c          *include_set;
+  /* Socket shared with the receiver by the datagram and AF_XDP backends.  -1 if senders open their own sockets */
+  int                           shared_sockfd;
+  /* AF_XDP socket behind shared_sockfd.  nullptr for other backends */
+  xdp_socket_c                 *xdp_socket;
+  probe_cookie_key_s            cookie_key;
+  /* ICMP identifier of every echo request */
+  uint16_t                      identifier;
 } send_thread_args_s;
 
+/* Batches per second when pacing to a target rate */
+#define SEND_RATE_BATCHES_PER_SECOND 1000
+
+/* Hands each ping block from the send thread to the send shard threads */
+typedef struct
+{
+  pthread_mutex_t  mutex;
+  pthread_cond_t   cond;
+  ping_block_c    *ping_block;
+  unsigned long    generation;
+  unsigned int     shard_count;
+} send_shard_handoff_s;
+
+typedef struct
+{
+  send_shard_handoff_s      *handoff;
+  const ping_block_config_s *ping_block_config;
+  unsigned int               shard;
+  int                        shared_sockfd;
+} send_shard_thread_args_s;
+
+void *send_shard_thread_f(void* arg)
+{
+  send_shard_thread_args_s *send_shard_thread_args = (send_shard_thread_args_s*) arg;
+  send_shard_handoff_s     *handoff;
+  ping_block_c             *ping_block;
+  unsigned long             last_generation = 0;
+  unsigned int              shard_count;
+  int                       sockfd;
+  send_engine_config_s      send_engine_config;
+  send_engine_c            *send_engine;
+  cpu_set_t                 cpu_set;
+  int                       affinity_code;
+
+  assert(send_shard_thread_args);
+  assert(send_shard_thread_args->handoff);
+  assert(send_shard_thread_args->ping_block_config);
+  handoff = send_shard_thread_args->handoff;
+
+  /* Spread shards across CPUs */
+  CPU_ZERO(&cpu_set);
+  CPU_SET((send_shard_thread_args->shard % MAX(1, sysconf(_SC_NPROCESSORS_ONLN))), &cpu_set);
+  affinity_code = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+  if(0 != affinity_code)
+  {
+    fprintf(stderr, "Failed to set CPU affinity for send shard %u.  error %d: %s\n", 
+      send_shard_thread_args->shard, affinity_code, strerror(affinity_code));
+  }
+
+  /* Each shard sends on its own socket unless the backend shares one with the receiver */
+  sockfd = send_shard_thread_args->shared_sockfd;
+  if(-1 == sockfd)
+  {
+    sockfd = ping_block_c::open_socket(send_shard_thread_args->ping_block_config);
+  }
+  ping_block_c::init_send_engine_config(send_shard_thread_args->ping_block_config, &send_engine_config);
+  send_engine = new send_engine_c(sockfd, &send_engine_config);
+
+  while(true)
+  {
+    assert(0 == pthread_mutex_lock(&handoff->mutex));
+    while(handoff->generation == last_generation)
+    {
+      assert(0 == pthread_cond_wait(&handoff->cond, &handoff->mutex));
+    }
+    last_generation = handoff->generation;
+    ping_block      = handoff->ping_block;
+    shard_count     = handoff->shard_count;
+    assert(0 == pthread_mutex_unlock(&handoff->mutex));
+
+    ping_block->dispatch_shard(send_engine, send_shard_thread_args->shard, shard_count);
+  }
+
+  delete send_engine;
+  if(sockfd != send_shard_thread_args->shared_sockfd)
+  {
+    close(sockfd);
+  }
+  return nullptr;
+}
+
+typedef struct
+{
+  ping_logger_c             *ping_logger;
+  const ping_block_config_s *ping_block_config;
+  int                        shared_sockfd;
+} retry_thread_args_s;
+
+/* Sends the retry pass of every ping block once its retry delay has passed.
+    Sends on its own socket, sharing the send thread's rate limiter so retries come out of the same rate */
+void *retry_thread_f(void* arg)
+{
+  retry_thread_args_s  *retry_thread_args = (retry_thread_args_s*) arg;
+  ping_block_c         *ping_block;
+  int                   sockfd;
+  send_engine_config_s  send_engine_config;
+  send_engine_c        *send_engine;
+  struct timespec       time_since_dispatch;
+  struct timespec       retry_wait_time;
+
+  assert(retry_thread_args);
+  assert(retry_thread_args->ping_logger);
+  assert(retry_thread_args->ping_block_config);
+
+  sockfd = retry_thread_args->shared_sockfd;
+  if(-1 == sockfd)
+  {
+    sockfd = ping_block_c::open_socket(retry_thread_args->ping_block_config);
+  }
+  ping_block_c::init_send_engine_config(retry_thread_args->ping_block_config, &send_engine_config);
+  send_engine = new send_engine_c(sockfd, &send_engine_config);
+
+  while(true)
+  {
+    ping_block = retry_thread_args->ping_logger->wait_for_ping_block_retry();
+    ping_block->wait_dispatch_done();
+    time_since_dispatch = ping_block->time_since_dispatch();
+    if(diff_timespec(&retry_thread_args->ping_block_config->retry_delay, &time_since_dispatch, &retry_wait_time))
+    {
+      nanosleep(&retry_wait_time, nullptr);
+    }
+    ping_block->dispatch_retry(send_engine);
+  }
+
+  delete send_engine;
+  if(sockfd != retry_thread_args->shared_sockfd)
+  {
+    close(sockfd);
+  }
+  return nullptr;
+}
+
+/* First address of the ping block holding the next included address at or after first_address.
+    Ping blocks without an included address are never created, blocks stay aligned to block_origin */
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+uint32_t next_included_ping_block(const address_set_c *include_set, uint32_t first_address, uint32_t block_origin, unsigned int address_count)
+{
+  size_t   range_index;
+  uint32_t target_address;
+
+  assert(include_set != nullptr);
+  assert(include_set->get_range_count() > 0);
+
+  range_index = include_set->lower_bound(first_address);
+  if(range_index < include_set->get_range_count())
+  {
+    target_address = MAX(first_address, include_set->get_range(range_index).first);
+  }
+  else
+  {
+    /* Wrap around the address space like a full sweep */
+    target_address = include_set->get_range(0).first;
+  }
+
+  return (uint32_t)(block_origin + (((uint32_t)(target_address-block_origin)/address_count)*address_count));
+}
+
+/* First address of the next ping block in shard at or after the ping block holding first_address.
+    Shards take every shard_count'th ping block counted from 0.0.0.0, so every instance agrees on the split wherever it starts.
+    address_count must be a power of two */
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+uint32_t next_shard_ping_block(uint32_t first_address, unsigned int address_count, unsigned int shard, unsigned int shard_count)
+{
+  const uint_fast64_t block_count = ((MAX_IP+1ULL)/address_count);
+  const uint_fast64_t block_index = (first_address/address_count);
+  uint_fast64_t       shard_block_index;
+
+  assert(shard < shard_count);
+  assert(shard_count <= block_count);
+
+  shard_block_index = (block_index + ((shard + shard_count - (block_index % shard_count)) % shard_count));
+  if(shard_block_index >= block_count)
+  {
+    /* Wrap around the address space like a full sweep */
+    shard_block_index = shard;
+  }
+
+  return (uint32_t)(shard_block_index*address_count);
+}
+
+/* Size of the next ping block for --block-duration from the send rate of the last, which sent pings_sent pings in dispatch_time.
+    Skipped addresses cost next to nothing so the rate is of pings sent rather than addresses.  Whole /24s within the adaptive bounds */
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+unsigned int adapt_ping_block_size(unsigned int address_count, unsigned int pings_sent, struct timespec dispatch_time, unsigned int block_duration)
+{
+  const uint_fast64_t dispatch_us = MAX(1UL, (uint_fast64_t)TIMESPEC_TO_US(dispatch_time));
+  const uint_fast64_t growth_max  = ((uint_fast64_t)address_count)*PINGO_ADAPTIVE_PING_BLOCK_GROWTH_MAX;
+  uint_fast64_t       next_count  = growth_max;
+
+  if(pings_sent > 0)
+  {
+    next_count = MIN(growth_max, (((uint_fast64_t)pings_sent)*SECONDS_TO_MS(block_duration)*1000UL)/dispatch_us);
+  }
+  next_count = ((next_count/PINGO_ADAPTIVE_PING_BLOCK_SIZE_MIN)*PINGO_ADAPTIVE_PING_BLOCK_SIZE_MIN);
+
+  return (unsigned int)MIN(MAX(next_count, (uint_fast64_t)PINGO_ADAPTIVE_PING_BLOCK_SIZE_MIN), (uint_fast64_t)PINGO_ADAPTIVE_PING_BLOCK_SIZE_MAX);
+}
+
+/* Ping blocks built by the prepare thread ahead of the send thread dispatching them */
+typedef struct
+{
+  pthread_mutex_t           mutex;
+  pthread_cond_t            ready_cond;
+  pthread_cond_t            space_cond;
+  std::deque<ping_block_c*> ready;
+  /* Most ping blocks built ahead */
+  unsigned int              depth;
+  /* Size of the next ping block built.  Updated by the send thread with --block-duration.
+      Blocks already built keep their size, so sizing lags dispatch by up to depth blocks */
+  unsigned int              address_count;
+} ping_block_prepare_queue_s;
+
+typedef struct
+{
+  ping_block_prepare_queue_s *queue;
+  ping_logger_c              *ping_logger;
+  const ping_block_config_s  *ping_block_config;
+  uint32_t                    first_address;
+  /* Ping blocks start on multiples of alignment from origin */
+  uint32_t                    origin;
+  unsigned int                alignment;
+  /* Ping block sizes may not divide the address space */
+  bool                        variable_size;
+  unsigned int                shard;
+  unsigned int                shard_count;
+} prepare_thread_args_s;
+
+/* Builds the next ping blocks in scan order so the send thread always has one ready.
+    Finds the next block in the shard holding an included address, waits for room in the ping block window and
+    allocates and initializes the block, checking it against the exclude list */
+void *prepare_thread_f(void* arg)
+{
+  prepare_thread_args_s      *prepare_thread_args = (prepare_thread_args_s*) arg;
+  ping_block_prepare_queue_s *queue;
+  ping_block_c               *ping_block;
+  uint32_t                    first_address;
+  uint32_t                    scanned_first_address;
+  uint_fast64_t               searched_blocks;
+  unsigned int                address_count;
+
+  assert(prepare_thread_args);
+  assert(prepare_thread_args->queue);
+  assert(prepare_thread_args->ping_logger);
+  assert(prepare_thread_args->ping_block_config);
+  queue         = prepare_thread_args->queue;
+  first_address = prepare_thread_args->first_address;
+
+  while(true)
+  {
+    assert(0 == pthread_mutex_lock(&queue->mutex));
+    while(queue->ready.size() >= queue->depth)
+    {
+      assert(0 == pthread_cond_wait(&queue->space_cond, &queue->mutex));
+    }
+    address_count = queue->address_count;
+    assert(0 == pthread_mutex_unlock(&queue->mutex));
+
+    /* Advance to the next ping block which is in this shard and holds an included address */
+    searched_blocks = 0;
+    do
+    {
+      scanned_first_address = first_address;
+      if(prepare_thread_args->ping_block_config->include_set != nullptr)
+      {
+        first_address = next_included_ping_block(prepare_thread_args->ping_block_config->include_set, first_address, 
+                                                 prepare_thread_args->origin, prepare_thread_args->alignment);
+      }
+      if(prepare_thread_args->shard_count > 1)
+      {
+        first_address = next_shard_ping_block(first_address, address_count, prepare_thread_args->shard, prepare_thread_args->shard_count);
+      }
+
+      if(++searched_blocks > ((MAX_IP+1ULL)/prepare_thread_args->alignment))
+      {
+        fprintf(stderr, "No address of the include list is in shard %u of %u.\n", prepare_thread_args->shard, prepare_thread_args->shard_count);
+        safe_exit(1);
+      }
+    } while(scanned_first_address != first_address);
+    if(prepare_thread_args->variable_size)
+    {
+      /* End the last block at the top of the address space instead of wrapping within a block */
+      address_count = (unsigned int)MIN((uint_fast64_t)address_count, ((MAX_IP+1ULL)-first_address));
+    }
+    /* Holds off allocating the next ping block until the writer has released enough soaked ones */
+    prepare_thread_args->ping_logger->wait_for_ping_block_window(ping_block_c::get_memory_size(address_count));
+    ping_block    = new ping_block_c(first_address, address_count, prepare_thread_args->ping_block_config);
+    first_address = ping_block->get_last_address();
+
+    assert(0 == pthread_mutex_lock(&queue->mutex));
+    queue->ready.push_back(ping_block);
+    assert(0 == pthread_cond_signal(&queue->ready_cond));
+    assert(0 == pthread_mutex_unlock(&queue->mutex));
+  }
+
+  return nullptr;
+}
+
 void *send_thread_f(void* arg)
 {
   ping_block_config_s    ping_block_config;
@@ -265,8 +638,26 @@ void *send_thread_f(void* arg)
   send_thread_args_s    *send_thread_args = (send_thread_args_s*) arg;
   ping_logger_c         *ping_logger;
   uint32_t               ping_block_first_address;
-  unsigned int           ping_block_address_count = 65536;
+  uint32_t               ping_block_origin;
+  unsigned int           ping_block_address_count = PINGO_DEFAULT_PING_BLOCK_SIZE;
+  /* Ping blocks start on multiples of this from ping_block_origin */
+  unsigned int           ping_block_alignment;
+  unsigned int           block_duration = 0;
   const struct timespec  cool_down = {.tv_sec = 0, .tv_nsec = 0};
+  unsigned int           send_threads = 1;
+  send_shard_handoff_s   send_shard_handoff;
+  std::vector<pthread_t> send_shard_threads;
+  std::vector<send_shard_thread_args_s> send_shard_thread_args;
+  int                    sockfd = -1;
+  send_engine_config_s   send_engine_config;
+  send_engine_c         *send_engine = nullptr;
+  unsigned int           shard = 0;
+  unsigned int           shard_count = 1;
+  ping_block_prepare_queue_s prepare_queue;
+  pthread_t              prepare_thread;
+  prepare_thread_args_s  prepare_thread_args;
+  pthread_t              retry_thread;
+  retry_thread_args_s    retry_thread_args;
 
   assert(send_thread_args);
   assert(send_thread_args->ping_logger);
@@ -274,9 +665,15 @@ void *send_thread_f(void* arg)
 
   ping_block_c::init_config(&ping_block_config); 
   ping_block_config.verbose = false;
-  ping_block_config.fixed_sequence_number = true;
-  ping_block_config.sequence_number = getpid();
-  ping_block_config.excluded_ip_list = send_thread_args->excluded_ip_list;
+  ping_block_config.cookie_key = send_thread_args->cookie_key;
+  ping_block_config.identifier = send_thread_args->identifier;
+  ping_block_config.exclude_set = send_thread_args->exclude_set;
+  ping_block_config.include_set = send_thread_args->include_set;
+  ping_block_config.skip_reserved = (PINGO_ARGUMENT_VALID != send_thread_args->ping_block_args.scan_reserved_status);
+  ping_block_config.tx_timestamps = (PINGO_ARGUMENT_VALID == send_thread_args->ping_block_args.tx_timestamps_status);
+  /* Retry passes share the dispatch socket's error queue, so each reads stamps of the other live ping blocks */
+  ping_block_config.foreign_tx_timestamp_cb            = ping_logger_c::log_tx_timestamp_cb;
+  ping_block_config.foreign_tx_timestamp_user_data_ptr = ping_logger;
 
   if(PINGO_ARGUMENT_VALID == send_thread_args->ping_block_args.initial_ip_status)
   {
@@ -290,45 +687,263 @@ void *send_thread_f(void* arg)
   {
     ping_block_address_count = send_thread_args->ping_block_args.address_length; 
   }
+  ping_block_alignment = ping_block_address_count;
+  if(PINGO_ARGUMENT_VALID == send_thread_args->ping_block_args.block_duration_status)
+  {
+    /* Every adaptive size is whole /24s so blocks stay on the /24 grid from the first address */
+    block_duration           = send_thread_args->ping_block_args.block_duration;
+    ping_block_alignment     = PINGO_ADAPTIVE_PING_BLOCK_SIZE_MIN;
+    ping_block_address_count = MIN(MAX(((ping_block_address_count/PINGO_ADAPTIVE_PING_BLOCK_SIZE_MIN)*PINGO_ADAPTIVE_PING_BLOCK_SIZE_MIN), 
+                                       (unsigned int)PINGO_ADAPTIVE_PING_BLOCK_SIZE_MIN), (unsigned int)PINGO_ADAPTIVE_PING_BLOCK_SIZE_MAX);
+    printf("Sizing ping blocks to dispatch in about %u seconds, between %u and %u addresses starting at %u.\n", 
+      block_duration, PINGO_ADAPTIVE_PING_BLOCK_SIZE_MIN, PINGO_ADAPTIVE_PING_BLOCK_SIZE_MAX, ping_block_address_count);
+  }
   if(PINGO_ARGUMENT_VALID == send_thread_args->ping_block_args.cooldown_status)
   {
     MS_TO_TIMESPEC(send_thread_args->ping_block_args.cooldown, ping_block_config.ping_batch_cooldown); 
   }
+  if(PINGO_ARGUMENT_VALID == send_thread_args->ping_block_args.send_threads_status)
+  {
+    send_threads = send_thread_args->ping_block_args.send_threads;
+  }
+  if(PINGO_ARGUMENT_VALID == send_thread_args->ping_block_args.permute_status)
+  {
+    ping_block_config.scan_order = SCAN_ORDER_PERMUTED;
+    if(PINGO_ARGUMENT_VALID == send_thread_args->ping_block_args.seed_status)
+    {
+      ping_block_config.scan_seed = send_thread_args->ping_block_args.seed;
+    }
+    else
+    {
+      struct timespec seed_time;
+      clock_gettime(CLOCK_REALTIME, &seed_time);
+      ping_block_config.scan_seed = ((((uint_fast64_t)seed_time.tv_sec) << 32) ^ seed_time.tv_nsec ^ getpid());
+    }
+    printf("Permuting scan order of ping blocks with seed %lu.\n", ping_block_config.scan_seed);
+  }
+  if(PINGO_ARGUMENT_VALID == send_thread_args->ping_block_args.send_backend_status)
+  {
+    ping_block_config.send_backend = send_thread_args->ping_block_args.send_backend;
+    memcpy(ping_block_config.send_interface, send_thread_args->ping_block_args.interface, sizeof(ping_block_config.send_interface));
+    memcpy(ping_block_config.gateway_mac, send_thread_args->ping_block_args.gateway_mac, sizeof(ping_block_config.gateway_mac));
+    ping_block_config.xdp_socket = send_thread_args->xdp_socket;
+  }
+  if(send_thread_args->rate_controller != nullptr)
+  {
+    /* Batches sized for the lowest rate the controller may pick */
+    ping_block_config.ping_batch_size = MAX(1U, MIN(ping_block_config.ping_batch_size, 
+                                                    (send_thread_args->ping_block_args.min_rate/SEND_RATE_BATCHES_PER_SECOND)));
+    ping_block_config.rate_limiter    = new rate_limiter_c(send_thread_args->rate_controller->get_rate(), ping_block_config.ping_batch_size);
+    printf("Adapting send rate between %u and %u pings per second starting at %lu, in batches of %u.\n", 
+      send_thread_args->ping_block_args.min_rate, send_thread_args->ping_block_args.max_rate, 
+      send_thread_args->rate_controller->get_rate(), ping_block_config.ping_batch_size);
+  }
+  else if(PINGO_ARGUMENT_VALID == send_thread_args->ping_block_args.rate_status)
+  {
+    /* Keep bursts within about 1ms of the target rate so low rates are not sent as large bursts */
+    ping_block_config.ping_batch_size = MAX(1U, MIN(ping_block_config.ping_batch_size, 
+                                                    (send_thread_args->ping_block_args.rate/SEND_RATE_BATCHES_PER_SECOND)));
+    ping_block_config.rate_limiter    = new rate_limiter_c(send_thread_args->ping_block_args.rate, ping_block_config.ping_batch_size);
+    printf("Pacing pings to %u per second in batches of %u.\n", send_thread_args->ping_block_args.rate, ping_block_config.ping_batch_size);
+  }
+  if(PINGO_ARGUMENT_VALID == send_thread_args->ping_block_args.send_buffer_status)
+  {
+    ping_block_config.socket_send_buffer = send_thread_args->ping_block_args.send_buffer;
+  }
+
+  if(PINGO_ARGUMENT_VALID == send_thread_args->ping_block_args.rate_per_24_status)
+  {
+    ping_block_config.prefix_caps.max_rate_24 = send_thread_args->ping_block_args.rate_per_24;
+    printf("Capping pings into any one /24 at %u per second.\n", send_thread_args->ping_block_args.rate_per_24);
+  }
+  if(PINGO_ARGUMENT_VALID == send_thread_args->ping_block_args.rate_per_16_status)
+  {
+    ping_block_config.prefix_caps.max_rate_16 = send_thread_args->ping_block_args.rate_per_16;
+    printf("Capping pings into any one /16 at %u per second.\n", send_thread_args->ping_block_args.rate_per_16);
+  }
+
+  if(PINGO_ARGUMENT_VALID == send_thread_args->ping_block_args.retry_after_status)
+  {
+    ping_block_config.retry_delay.tv_sec = send_thread_args->ping_block_args.retry_after;
+    printf("Retrying addresses which have not replied %u seconds after their ping block dispatched.\n", 
+      send_thread_args->ping_block_args.retry_after);
+
+    retry_thread_args.ping_logger       = ping_logger;
+    retry_thread_args.ping_block_config = &ping_block_config;
+    retry_thread_args.shared_sockfd     = send_thread_args->shared_sockfd;
+    pthread_create(&retry_thread, nullptr, retry_thread_f, &retry_thread_args);
+  }
+
+  if(send_threads > 1)
+  {
+    printf("Dispatching ping blocks with %u send threads.\n", send_threads);
+
+    assert(0 == pthread_mutex_init(&send_shard_handoff.mutex, nullptr));
+    assert(0 == pthread_cond_init(&send_shard_handoff.cond, nullptr));
+    send_shard_handoff.ping_block  = nullptr;
+    send_shard_handoff.generation  = 0;
+    send_shard_handoff.shard_count = send_threads;
+
+    send_shard_threads.resize(send_threads);
+    send_shard_thread_args.resize(send_threads);
+    for(unsigned int i = 0; i < send_threads; i++)
+    {
+      send_shard_thread_args[i].handoff           = &send_shard_handoff;
+      send_shard_thread_args[i].ping_block_config = &ping_block_config;
+      send_shard_thread_args[i].shard             = i;
+      send_shard_thread_args[i].shared_sockfd     = send_thread_args->shared_sockfd;
+      pthread_create(&send_shard_threads[i], nullptr, send_shard_thread_f, &send_shard_thread_args[i]);
+    }
+  }
+  else
+  {
+    /* Socket and send engine live as long as the send thread instead of being rebuilt for every ping block */
+    sockfd = send_thread_args->shared_sockfd;
+    if(-1 == sockfd)
+    {
+      sockfd = ping_block_c::open_socket(&ping_block_config);
+    }
+    ping_block_c::init_send_engine_config(&ping_block_config, &send_engine_config);
+    send_engine = new send_engine_c(sockfd, &send_engine_config);
+  }
+
+  ping_block_origin = ping_block_first_address;
+  if(PINGO_ARGUMENT_VALID == send_thread_args->ping_block_args.shard_status)
+  {
+    /* Shards are aligned to the address space instead of the first address so every instance splits it the same way */
+    shard             = send_thread_args->ping_block_args.shard;
+    shard_count       = send_thread_args->ping_block_args.shard_count;
+    ping_block_origin = 0;
+    printf("Scanning shard %u/%u, ping blocks of %u addresses numbered from 0.0.0.0 whose number modulo %u is %u.\n", 
+      shard, shard_count, ping_block_address_count, shard_count, shard);
+  }
+
+  /* Blocks are built on another thread so the wire does not idle while the next one is allocated */
+  assert(0 == pthread_mutex_init(&prepare_queue.mutex, nullptr));
+  assert(0 == pthread_cond_init(&prepare_queue.ready_cond, nullptr));
+  assert(0 == pthread_cond_init(&prepare_queue.space_cond, nullptr));
+  prepare_queue.depth         = PINGO_DEFAULT_PREPARE_BLOCKS;
+  prepare_queue.address_count = ping_block_address_count;
+  if(PINGO_ARGUMENT_VALID == send_thread_args->ping_block_args.prepare_blocks_status)
+  {
+    prepare_queue.depth = send_thread_args->ping_block_args.prepare_blocks;
+    printf("Preparing up to %u ping blocks ahead of dispatch.\n", prepare_queue.depth);
+  }
+  prepare_thread_args.queue             = &prepare_queue;
+  prepare_thread_args.ping_logger       = ping_logger;
+  prepare_thread_args.ping_block_config = &ping_block_config;
+  prepare_thread_args.first_address     = ping_block_first_address;
+  prepare_thread_args.origin            = ping_block_origin;
+  prepare_thread_args.alignment         = ping_block_alignment;
+  prepare_thread_args.variable_size     = (block_duration > 0);
+  prepare_thread_args.shard             = shard;
+  prepare_thread_args.shard_count       = shard_count;
+  pthread_create(&prepare_thread, nullptr, prepare_thread_f, &prepare_thread_args);
 
   while(true)
   {
-    ping_block = new ping_block_c(ping_block_first_address, ping_block_address_count, &ping_block_config);
-    ping_block_first_address = ping_block->get_last_address();
+    assert(0 == pthread_mutex_lock(&prepare_queue.mutex));
+    while(prepare_queue.ready.empty())
+    {
+      assert(0 == pthread_cond_wait(&prepare_queue.ready_cond, &prepare_queue.mutex));
+    }
+    ping_block = prepare_queue.ready.front();
+    prepare_queue.ready.pop_front();
+    assert(0 == pthread_cond_signal(&prepare_queue.space_cond));
+    assert(0 == pthread_mutex_unlock(&prepare_queue.mutex));
+
     ping_logger->push_ping_block(ping_block);
-    ping_block->dispatch();
+    if(send_threads > 1)
+    {
+      assert(0 == pthread_mutex_lock(&send_shard_handoff.mutex));
+      send_shard_handoff.ping_block = ping_block;
+      send_shard_handoff.generation++;
+      assert(0 == pthread_cond_broadcast(&send_shard_handoff.cond));
+      assert(0 == pthread_mutex_unlock(&send_shard_handoff.mutex));
+      ping_block->wait_dispatch_done();
+    }
+    else
+    {
+      ping_block->dispatch_shard(send_engine, 0, 1);
+    }
+    if(send_thread_args->rate_controller != nullptr)
+    {
+      const ping_block_dispatch_stats_s dispatch_stats = ping_block->get_dispatch_stats();
+      const rate_controller_action_e    rate_action    = 
+        send_thread_args->rate_controller->dispatch_feedback(dispatch_stats.pings_sent, dispatch_stats.send_retries, dispatch_stats.send_drops);
+      if(RATE_CONTROLLER_ACTION_DECREASE_SEND_ERRORS == rate_action)
+      {
+        printf("Send rate %s to %lu pings per second.\n", 
+          rate_controller_c::action_string(rate_action), send_thread_args->rate_controller->get_rate());
+      }
+      /* Also applies decreases from reply yield fed back by the writer */
+      ping_block_config.rate_limiter->set_rate(send_thread_args->rate_controller->get_rate());
+    }
+    if(block_duration > 0)
+    {
+      /* Blocks already prepared keep their size, the next one built takes the new size */
+      ping_block_address_count = adapt_ping_block_size(ping_block->get_address_count(), ping_block->get_dispatch_stats().pings_sent, 
+                                                       ping_block->get_dispatch_time(), block_duration);
+      assert(0 == pthread_mutex_lock(&prepare_queue.mutex));
+      prepare_queue.address_count = ping_block_address_count;
+      assert(0 == pthread_mutex_unlock(&prepare_queue.mutex));
+    }
     nanosleep(&cool_down, nullptr);
   }
 
+  delete send_engine;
+  if(sockfd != send_thread_args->shared_sockfd)
+  {
+    close(sockfd);
+  }
   return nullptr;
 }
 
+typedef struct
+{
+  ping_logger_c *ping_logger;
+  /* ICMP datagram socket shared with the senders.  -1 to open a raw ICMP socket */
+  int            shared_sockfd;
+  /* AF_XDP socket shared with the senders, which receives in place of shared_sockfd.  nullptr for other backends */
+  xdp_socket_c  *xdp_socket;
+  /* Key the senders' probe cookies were generated with */
+  probe_cookie_key_s cookie_key;
+  /* ICMP identifier of the senders' echo requests.  Replies with another identifier are for other pingers */
+  uint16_t       identifier;
+} recv_thread_args_s;
+
 void *recv_thread_f(void* arg)
 {
-  ping_logger_c         *ping_logger = (ping_logger_c*) arg;
-  int sockfd = socket(AF_INET, SOCK_RAW, IPPROTO_ICMP);
+  recv_thread_args_s    *recv_thread_args = (recv_thread_args_s*) arg;
+  ping_logger_c         *ping_logger = recv_thread_args->ping_logger;
+  xdp_socket_c          *xdp_socket = recv_thread_args->xdp_socket;
+  /* Datagram sockets receive only our echo replies, without IPv4 header */
+  const bool datagram = ((-1 != recv_thread_args->shared_sockfd) && (nullptr == xdp_socket));
+  int sockfd = ((-1 != recv_thread_args->shared_sockfd)?recv_thread_args->shared_sockfd:socket(AF_INET, SOCK_RAW, IPPROTO_ICMP));
   ipv4_packet_meta_s ipv4_packet_meta;
   icmp_packet_meta_s icmp_packet_meta;
   pingo_payload_t pingo_payload;
-  struct timespec ping_reply_time;
+  probe_cookie_t cookie;
+  uint32_t request_age;
+  uint32_t ping_reply_time;
   struct timespec time_diff;
-  char ip_string_buffer_a[IP_STRING_SIZE], ip_string_buffer_b[IP_STRING_SIZE];
+  char ip_string_buffer_a[IP_STRING_SIZE];
   struct timeval recv_timeout;
   unsigned int recv_timeouts = 0;
-  ssize_t recv_bytes;
+  int recv_count;
   const bool verbose = false;
-  const uint16_t sequence_id = getpid();
   ping_log_entry_s log_entry;
-  struct sockaddr_in src_addr;
-  socklen_t addrlen;
-  ipv4_word_t buffer[IPV4_MAX_PACKET_SIZE_WORDS];
+  /* Validated replies of one receive batch, pushed to the logger together */
+  std::vector<ping_log_entry_s> log_entries;
+  recv_engine_config_s recv_engine_config;
+  recv_engine_c *recv_engine;
+  recv_engine_packet_s packet;
+  const int enable = 1;
+  /* Invalid packets are reported as a count at most once per interval rather than one line each */
+  uint_fast64_t  invalid_packets_reported = 0;
+  timestamp_ns_t invalid_packets_report_time = get_timestamp_ns();
 
   memset(&pingo_payload, 0, sizeof(pingo_payload));
-  memset(&ping_reply_time, 0, sizeof(ping_reply_time));
   memset(&time_diff, 0, sizeof(time_diff));
 
   if(sockfd == -1)
@@ -354,15 +969,24 @@ void *recv_thread_f(void* arg)
   recv_timeout.tv_usec = 0;
   setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, (const char*)&recv_timeout, sizeof(recv_timeout));
 
-  while(true)
+  /* Replies are stamped by the kernel on arrival, so time spent queued on the socket is not counted.
+      AF_XDP replies bypass the kernel and are timed when read */
+  if( (nullptr == xdp_socket) &&
+      (0 != setsockopt(sockfd, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable))) )
   {
-    memset(&buffer, 0, sizeof(buffer));
+    fprintf(stderr, "Failed to enable receive timestamps, replies are timed when read.  errno %u: %s\n", errno, strerror(errno));
+  }
 
-    recv_bytes = recvfrom(sockfd, &buffer, sizeof(buffer), 0, (struct sockaddr*) &src_addr, &addrlen);
-    
-    get_time(&ping_reply_time);
+  recv_engine_c::init_config(&recv_engine_config);
+  recv_engine_config.xdp_socket = xdp_socket;
+  recv_engine_config.timeout_ms = (int)SECONDS_TO_MS(recv_timeout.tv_sec);
+  recv_engine = new recv_engine_c(sockfd, &recv_engine_config);
+  log_entries.reserve(recv_engine_config.batch_size);
 
-    if(-1 == recv_bytes)
+  while(true)
+  {
+    recv_count = recv_engine->receive();
+    if(-1 == recv_count)
     {
       switch(errno)
       {
@@ -382,104 +1006,147 @@ void *recv_thread_f(void* arg)
         }
       }
     }
-    else if(0 == recv_bytes)
-    {
-      printf("Empty packet.\n");
-    }
-    if(sizeof(struct sockaddr_in) != addrlen)
-    {
-      fprintf(stderr, "Received packet src_addr length unexpected.  addrlen %u expected %lu\n", addrlen, sizeof(struct sockaddr_in));
-    }
-    else
+
+    log_entries.clear();
+    for(int i = 0; i < recv_count; i++)
     {
-      ipv4_packet_meta = parse_ipv4_packet(buffer, sizeof(buffer));
+      packet = recv_engine->get_packet((unsigned int)i);
+      ping_reply_time = ((packet.rx_time != 0)?(uint32_t)(packet.rx_time/TIMESTAMP_NS_PER_US):get_timestamp_us32());
 
-      if(ipv4_packet_meta.header_valid)
+      if(0 == packet.size)
+      {
+        printf("Empty packet.\n");
+      }
+      else if(sizeof(struct sockaddr_in) != packet.addrlen)
       {
-        icmp_packet_meta = parse_icmp_packet(&ipv4_packet_meta.payload);
-        ip_string(ipv4_packet_meta.header.source_ip, ip_string_buffer_a, sizeof(ip_string_buffer_a));
-        if(icmp_packet_meta.header_valid)
+        fprintf(stderr, "Received packet src_addr length unexpected.  addrlen %u expected %lu\n", packet.addrlen, sizeof(struct sockaddr_in));
+      }
+      else
+      {
+        if(datagram)
+        {
+          /* Only the IPv4 fields used below are filled in */
+          memset(&ipv4_packet_meta, 0, sizeof(ipv4_packet_meta));
+          ipv4_packet_meta.header_valid          = true;
+          ipv4_packet_meta.header.source_ip      = ntohl(packet.src_addr->sin_addr.s_addr);
+          ipv4_packet_meta.payload.buffer        = packet.buffer;
+          ipv4_packet_meta.payload.size          = packet.size;
+          ipv4_packet_meta.payload.size_in_words = BYTE_SIZE_TO_IPV4_WORD_SIZE(ipv4_packet_meta.payload.size);
+        }
+        else
+        {
+          /* Only the bytes received are parsed, rounded up to the word holding the last */
+          ipv4_packet_meta = parse_ipv4_packet(packet.buffer, 
+                                               IPV4_WORD_SIZE_TO_BYTE_SIZE(BYTE_SIZE_TO_IPV4_WORD_SIZE((packet.size+sizeof(ipv4_word_t)-1))));
+        }
+
+        if(ipv4_packet_meta.header_valid)
         {
-          switch(icmp_packet_meta.header.type)
+          icmp_packet_meta = parse_icmp_packet(&ipv4_packet_meta.payload);
+          ip_string(ipv4_packet_meta.header.source_ip, ip_string_buffer_a, sizeof(ip_string_buffer_a));
+          if(icmp_packet_meta.header_valid)
           {
-            case ICMP_TYPE_ECHO_REPLY:
+            switch(icmp_packet_meta.header.type)
             {
-              if(icmp_packet_meta.payload_size == sizeof(pingo_payload_t))
+              case ICMP_TYPE_ECHO_REPLY:
               {
-                pingo_payload = *((pingo_payload_t*)icmp_packet_meta.payload);
-
-                if( (ICMP_IDENTIFIER == icmp_packet_meta.header.rest_of_header.id_seq_num.identifier) &&
-                    (sequence_id == icmp_packet_meta.header.rest_of_header.id_seq_num.sequence_number) &&
-                    (ipv4_packet_meta.header.source_ip == pingo_payload.dest_address) &&
-                    (timespec_valid(&pingo_payload.request_time)) )
+                if(icmp_packet_meta.payload_size == sizeof(pingo_payload_t))
                 {
+                  memcpy(&pingo_payload, icmp_packet_meta.payload, sizeof(pingo_payload));
+
+                  /* Reply is ours if the cookie recomputed for the replying address matches, no per-probe state is kept */
+                  cookie      = probe_cookie(&recv_thread_args->cookie_key, ipv4_packet_meta.header.source_ip, pingo_payload.request_time);
+                  request_age = ping_reply_time - pingo_payload.request_time;
 
-                  memset(&log_entry, 0, sizeof(log_entry));
-                  log_entry.header.type=PING_LOG_ENTRY_ECHO_REPLY;
-                  log_entry.data.echo_reply.payload = pingo_payload;
-                  diff_timespec(&ping_reply_time, &pingo_payload.request_time, &log_entry.data.echo_reply.reply_delay);
-                  ping_logger->push_log_entry(log_entry);
+                  if(recv_thread_args->identifier != icmp_packet_meta.header.rest_of_header.id_seq_num.identifier)
+                  {
+                    /* Replies to other pingers on this host, including other shards of this scan */
+                    if(verbose)
+                    {
+                      printf("Echo reply from %s for identifier 0x%x ignored.\n", 
+                        ip_string_buffer_a, icmp_packet_meta.header.rest_of_header.id_seq_num.identifier);
+                    }
+                  }
+                  else if( (((uint16_t)cookie) == icmp_packet_meta.header.rest_of_header.id_seq_num.sequence_number) &&
+                      (((uint32_t)(cookie >> 32)) == pingo_payload.cookie) &&
+                      (request_age <= PINGO_PAYLOAD_MAX_AGE_US) )
+                  {
 
-                  if(verbose)
+                    memset(&log_entry, 0, sizeof(log_entry));
+                    log_entry.header.type=PING_LOG_ENTRY_ECHO_REPLY;
+                    log_entry.data.echo_reply.dest_address = ipv4_packet_meta.header.source_ip;
+                    US_TO_TIMESPEC(request_age, log_entry.data.echo_reply.reply_delay);
+                    log_entries.push_back(log_entry);
+
+                    if(verbose)
+                    {
+                      time_diff = log_entry.data.echo_reply.reply_delay;
+                      ip_string(ipv4_packet_meta.header.source_ip, ip_string_buffer_a, sizeof(ip_string_buffer_a));
+                      printf("Ping reply from %s in %lu.%09lus\n", ip_string_buffer_a, time_diff.tv_sec, time_diff.tv_nsec);
+                    }
+                  }
+                  else
                   {
                     ip_string(ipv4_packet_meta.header.source_ip, ip_string_buffer_a, sizeof(ip_string_buffer_a));
-                    printf("Ping reply from %s in %lu.%09lus\n", ip_string_buffer_a, time_diff.tv_sec, time_diff.tv_nsec);
+                    fprintf(stderr, "Invalid echo reply from %s.  identifier 0x%x (expected 0x%x) cookie 0x%08x%04x (expected 0x%08x%04x) request age %uus\n", 
+                            ip_string_buffer_a, 
+                            icmp_packet_meta.header.rest_of_header.id_seq_num.identifier, 
+                            recv_thread_args->identifier,
+                            pingo_payload.cookie,
+                            icmp_packet_meta.header.rest_of_header.id_seq_num.sequence_number, 
+                            (uint32_t)(cookie >> 32),
+                            (uint16_t)cookie,
+                            request_age);
                   }
                 }
                 else
                 {
                   ip_string(ipv4_packet_meta.header.source_ip, ip_string_buffer_a, sizeof(ip_string_buffer_a));
-                  ip_string(pingo_payload.dest_address, ip_string_buffer_b, sizeof(ip_string_buffer_b));
-                  fprintf(stderr, "Invalid echo reply payload from %s.  identifier 0x%x (expected 0x%x) sequence %u (expected %u) pingo_dest_address %s pingo_request_time %lu.%09lus\n", 
-                          ip_string_buffer_a, 
-                          icmp_packet_meta.header.rest_of_header.id_seq_num.identifier, 
-                          ICMP_IDENTIFIER,
-                          icmp_packet_meta.header.rest_of_header.id_seq_num.sequence_number, 
-                          sequence_id,
-                          ip_string_buffer_b,
-                          pingo_payload.request_time.tv_sec,
-                          pingo_payload.request_time.tv_nsec);
+                  fprintf(stderr, "Invalid echo reply payload size from %s.  payload_size %lu expected %lu\n", 
+                          ip_string_buffer_a, icmp_packet_meta.payload_size, sizeof(pingo_payload_t));
                 }
+                break;
               }
-              else
+              default:
               {
-                ip_string(ipv4_packet_meta.header.source_ip, ip_string_buffer_a, sizeof(ip_string_buffer_a));
-                fprintf(stderr, "Invalid echo reply payload size from %s.  payload_size %lu expected %lu\n", 
-                        ip_string_buffer_a, icmp_packet_meta.payload_size, sizeof(pingo_payload_t));
-              }
-              break;
-            }
-            default:
-            {
-              if(verbose)
-              {
-                printf("icmp valid %u from %s type %u code %u id %u seq_num %u payload_size %lu\n", 
-                        (unsigned int)icmp_packet_meta.header_valid,
-                        ip_string_buffer_a,
-                        icmp_packet_meta.header.type, 
-                        icmp_packet_meta.header.code, 
-                        icmp_packet_meta.header.rest_of_header.id_seq_num.identifier,
-                        icmp_packet_meta.header.rest_of_header.id_seq_num.sequence_number,
-                        icmp_packet_meta.payload_size);
+                if(verbose)
+                {
+                  printf("icmp valid %u from %s type %u code %u id %u seq_num %u payload_size %lu\n", 
+                          (unsigned int)icmp_packet_meta.header_valid,
+                          ip_string_buffer_a,
+                          icmp_packet_meta.header.type, 
+                          icmp_packet_meta.header.code, 
+                          icmp_packet_meta.header.rest_of_header.id_seq_num.identifier,
+                          icmp_packet_meta.header.rest_of_header.id_seq_num.sequence_number,
+                          icmp_packet_meta.payload_size);
+                }
               }
             }
           }
+          else
+          {
+            recv_engine->count_invalid_packet();
+          }
         }
         else
         {
-          ip_string(ntohl(src_addr.sin_addr.s_addr), ip_string_buffer_a, sizeof(ip_string_buffer_a));
-          fprintf(stderr, "Invalid packet from %s.  ICMP header valid %u\n", 
-            ip_string_buffer_a, (unsigned int) icmp_packet_meta.header_valid);
+          recv_engine->count_invalid_packet();
         }
       }
-      else
-      {
-        ip_string(ntohl(src_addr.sin_addr.s_addr), ip_string_buffer_a, sizeof(ip_string_buffer_a));
-        fprintf(stderr, "Invalid packet from %s.  IPv4 header valid %u\n", 
-          ip_string_buffer_a, (unsigned int) ipv4_packet_meta.header_valid);
-      }
+    }
+    ping_logger->push_log_entries(log_entries.data(), log_entries.size());
+
+    if( (recv_engine->get_stats().invalid_packets != invalid_packets_reported) &&
+        ((get_timestamp_ns()-invalid_packets_report_time) >= (PINGO_INVALID_PACKET_REPORT_INTERVAL*TIMESTAMP_NS_PER_S)) )
+    {
+      fprintf(stderr, "Dropped %lu invalid or truncated packets in the last %lus.\n", 
+        (recv_engine->get_stats().invalid_packets-invalid_packets_reported), 
+        (unsigned long)((get_timestamp_ns()-invalid_packets_report_time)/TIMESTAMP_NS_PER_S));
+      invalid_packets_reported    = recv_engine->get_stats().invalid_packets;
+      invalid_packets_report_time = get_timestamp_ns();
     }
   }
+  delete recv_engine;
   close(sockfd);
   return nullptr;
 }
@@ -496,72 +1163,43 @@ void signal_handler(int signal)
   }
 } 
 
-inline uint32_t cidr_subnet_to_subnet_mask(unsigned int subnet)
+bool load_ping_block_exclude_list(const char * path, address_set_c * exclude_list)
 {
-  subnet = ((subnet<=32)?subnet:32);
-  return (((1L << subnet)-1) << (32-subnet));
-}
-
-bool load_ping_block_exclude_list(char * path, ping_block_excluded_ip_list_t * exclude_list)
-{
-  bool ret_val = true;
+  bool                      ret_val;
+  address_list_load_stats_s stats;
 
   printf("Reading ping block IP exclude list '%s'.\n", path);
 
-  if((path != nullptr) && (exclude_list != nullptr))
+  ret_val = load_address_list(path, exclude_list, &stats);
+  if(ret_val)
   {
-    FILE * fp = fopen(path, "r");
+    printf("Loaded %u %s from exclude list into %zu ranges covering %lu addresses.  %u invalid lines.\n",
+      stats.entries, (stats.precompiled?"precompiled ranges":"CIDRs"), exclude_list->get_range_count(), 
+      (unsigned long) exclude_list->get_address_count(), stats.invalid_lines);
+  }
 
-    if(fp != nullptr)
-    {
-      unsigned int line_number = 1;
-      while(feof(fp) == 0)
-      {
-        char line[1024];
-        uint8_t byte_a, byte_b, byte_c, byte_d, subnet;
+  return ret_val;
+}
 
-        if((line == fgets(line, 1024, fp)) &&
-           (line[0] != '#') &&
-           (line[0] != '\n'))
-        {
-          const unsigned int items_read = sscanf(line, "%hhu.%hhu.%hhu.%hhu/%hhu", &byte_a, &byte_b, &byte_c, &byte_d, &subnet);
-          if ((4 == items_read) ||
-              (5 == items_read))
-          {
-            const ping_block_excluded_ip_s exclude_ip =
-              {
-                .ip = (uint32_t)((byte_a << 24) | (byte_b << 16) | (byte_c << 8) | (byte_d)),
-                .subnet_mask = cidr_subnet_to_subnet_mask((5 == items_read)?subnet:32),
-              };
-            exclude_list->push_back(exclude_ip);
-
-            char ip_string_buffer[IP_STRING_SIZE];
-            char subnet_string_buffer[IP_STRING_SIZE];
-            ip_string(exclude_ip.ip, ip_string_buffer, sizeof(ip_string_buffer));
-            ip_string(exclude_ip.subnet_mask, subnet_string_buffer, sizeof(subnet_string_buffer));
-            printf("Loaded IP %s with subnet mask %s from exclude list file.\n", ip_string_buffer, subnet_string_buffer);
-          }
-          else
-          {
-            fprintf(stderr, "Line %u: Unexpected IP format.  Expected CIDR format ###.###.###.###/##. - %s", line_number, line);
-          }
-        }
+bool load_ping_block_include_list(const char * path, address_set_c * include_list)
+{
+  bool                      ret_val;
+  address_list_load_stats_s stats;
 
-        line_number++;
-      }
-      assert(0 == fclose(fp));
-    }
-    else
+  printf("Reading ping block IP include list '%s'.\n", path);
+
+  ret_val = load_address_list(path, include_list, &stats);
+  if(ret_val)
+  {
+    printf("Loaded %u %s from include list into %zu ranges covering %lu addresses.  %u invalid lines.\n",
+      stats.entries, (stats.precompiled?"precompiled ranges":"CIDRs"), include_list->get_range_count(), 
+      (unsigned long) include_list->get_address_count(), stats.invalid_lines);
+    if(0 == include_list->get_range_count())
     {
-      fprintf(stderr, "Failed to open exclude list file '%s'.  errno %u: %s\n", path, errno, strerror(errno));
+      fprintf(stderr, "Include list '%s' has no addresses to ping.\n", path);
       ret_val = false;
     }
   }
-  else
-  {
-    fprintf(stderr, "Null inputs to load exclude list.  path %p excluded_list %p", path, exclude_list);
-    ret_val = false;
-  }
 
   return ret_val;
 }
@@ -574,6 +1212,7 @@ int main(int argc, char *argv[])
   file_manager_c *file_manager;
   send_thread_args_s send_thread_args;
   writer_thread_args_s writer_thread_args;
+  recv_thread_args_s recv_thread_args;
 
   signal(SIGINT,  signal_handler);
   signal(SIGTERM, signal_handler);
@@ -674,12 +1313,28 @@ int main(int argc, char *argv[])
     if(PINGO_ARGUMENT_VALID == args.ping_block_args.exclude_list_status)
     {
       printf("Reading excluded IP list.\n");
-      send_thread_args.excluded_ip_list = new ping_block_excluded_ip_list_t();
-      if(!load_ping_block_exclude_list(args.ping_block_args.exclude_list_path, send_thread_args.excluded_ip_list))
+      address_set_c *exclude_set = new address_set_c();
+      if(!load_ping_block_exclude_list(args.ping_block_args.exclude_list_path, exclude_set))
       {
         fprintf(stderr, "Failed to load exclude list from %s.\n", args.ping_block_args.exclude_list_path);
         safe_exit(1);
       }
+      if( (PINGO_ARGUMENT_VALID == args.ping_block_args.save_exclude_list_status) &&
+          !save_address_list(args.ping_block_args.save_exclude_list_path, exclude_set) )
+      {
+        safe_exit(1);
+      }
+      send_thread_args.exclude_set = exclude_set;
+    }
+    if(PINGO_ARGUMENT_VALID == args.ping_block_args.include_list_status)
+    {
+      address_set_c *include_set = new address_set_c();
+      if(!load_ping_block_include_list(args.ping_block_args.include_list_path, include_set))
+      {
+        fprintf(stderr, "Failed to load include list from %s.\n", args.ping_block_args.include_list_path);
+        safe_exit(1);
+      }
+      send_thread_args.include_set = include_set;
     }
 
     if(PINGO_ARGUMENT_VALID == args.ping_block_args.initial_ip_status)
@@ -693,14 +1348,92 @@ int main(int argc, char *argv[])
       send_thread_args.ping_block_first_address = file_manager->get_next_registry_hole_ip();
     }
 
+    /* Shards take their own identifier so instances on one host ignore each other's replies and can bind their own datagram socket */
+    send_thread_args.identifier = ICMP_IDENTIFIER;
+    if(PINGO_ARGUMENT_VALID == args.ping_block_args.shard_status)
+    {
+      send_thread_args.identifier = (uint16_t)(ICMP_IDENTIFIER + args.ping_block_args.shard);
+    }
+    recv_thread_args.identifier = send_thread_args.identifier;
+
+    /* Datagram socket replies are only delivered to the socket which sent the request */
+    send_thread_args.shared_sockfd = -1;
+    if( (PINGO_ARGUMENT_VALID == args.ping_block_args.send_backend_status) &&
+        (SEND_ENGINE_BACKEND_DATAGRAM == args.ping_block_args.send_backend) )
+    {
+      ping_block_config_s shared_socket_config;
+      ping_block_c::init_config(&shared_socket_config);
+      shared_socket_config.send_backend = SEND_ENGINE_BACKEND_DATAGRAM;
+      shared_socket_config.identifier   = send_thread_args.identifier;
+      shared_socket_config.tx_timestamps = (PINGO_ARGUMENT_VALID == args.ping_block_args.tx_timestamps_status);
+      if(PINGO_ARGUMENT_VALID == args.ping_block_args.send_buffer_status)
+      {
+        shared_socket_config.socket_send_buffer = args.ping_block_args.send_buffer;
+      }
+      send_thread_args.shared_sockfd    = ping_block_c::open_socket(&shared_socket_config);
+    }
+    /* Only one AF_XDP socket may be bound to the queue, so every sender and the receiver share it */
+    send_thread_args.xdp_socket = nullptr;
+    if( (PINGO_ARGUMENT_VALID == args.ping_block_args.send_backend_status) &&
+        (SEND_ENGINE_BACKEND_AF_XDP == args.ping_block_args.send_backend) )
+    {
+      xdp_socket_config_s xdp_socket_config;
+      ping_block_config_s default_ping_block_config;
+      ping_block_c::init_config(&default_ping_block_config);
+      xdp_socket_c::init_config(&xdp_socket_config);
+      memcpy(xdp_socket_config.interface, args.ping_block_args.interface, sizeof(xdp_socket_config.interface));
+      xdp_socket_config.copy_mode  = (PINGO_ARGUMENT_VALID == args.ping_block_args.xdp_copy_status);
+      xdp_socket_config.identifier = send_thread_args.identifier;
+      /* A batch of frames for every send engine, counting the retry thread's */
+      xdp_socket_config.tx_frames  = (default_ping_block_config.ping_batch_size*
+                                      (((PINGO_ARGUMENT_VALID == args.ping_block_args.send_threads_status)?args.ping_block_args.send_threads:1)+1));
+      send_thread_args.xdp_socket    = new xdp_socket_c(&xdp_socket_config);
+      send_thread_args.shared_sockfd = send_thread_args.xdp_socket->get_fd();
+      printf("Sending and receiving through AF_XDP socket on queue %u of %s in %s mode.\n", 
+        xdp_socket_config.queue, xdp_socket_config.interface, (xdp_socket_config.copy_mode?"copy":"zero-copy"));
+    }
+    recv_thread_args.ping_logger   = &ping_logger;
+    recv_thread_args.shared_sockfd = send_thread_args.shared_sockfd;
+    recv_thread_args.xdp_socket    = send_thread_args.xdp_socket;
+
+    ping_block_window_s ping_block_window;
+    ping_block_window.max_ping_blocks = ((PINGO_ARGUMENT_VALID == args.ping_block_args.window_blocks_status)?args.ping_block_args.window_blocks:0);
+    ping_block_window.max_bytes       = ((PINGO_ARGUMENT_VALID == args.ping_block_args.window_memory_status)?
+                                         (((size_t)args.ping_block_args.window_memory)*1024UL*1024UL):PING_LOGGER_DEFAULT_WINDOW_BYTES);
+    ping_logger.set_ping_block_window(&ping_block_window);
+
+    /* Calibrated before any thread takes timestamps */
+    init_timestamp();
+
+    /* Fresh key every run so replies to probes of an earlier run are rejected */
+    if(!init_probe_cookie_key(&send_thread_args.cookie_key))
+    {
+      safe_exit(1);
+    }
+    recv_thread_args.cookie_key = send_thread_args.cookie_key;
+
+    if(PINGO_ARGUMENT_VALID == args.ping_block_args.max_rate_status)
+    {
+      rate_controller_config_s rate_controller_config;
+      if(PINGO_ARGUMENT_VALID != args.ping_block_args.min_rate_status)
+      {
+        send_thread_args.ping_block_args.min_rate = MAX(1U, (args.ping_block_args.max_rate/RATE_CONTROLLER_DEFAULT_MIN_RATE_DIVISOR));
+      }
+      rate_controller_c::init_config(&rate_controller_config, send_thread_args.ping_block_args.min_rate, args.ping_block_args.max_rate);
+      send_thread_args.rate_controller = 
+        new rate_controller_c(((PINGO_ARGUMENT_VALID == args.ping_block_args.rate_status)?args.ping_block_args.rate:rate_controller_config.min_rate), 
+                              &rate_controller_config);
+    }
+
     memset(&writer_thread_args, 0, sizeof(writer_thread_args));
     writer_thread_args.args         = args.writer_args;
     writer_thread_args.ping_logger  = &ping_logger;
     writer_thread_args.file_manager = file_manager;
+    writer_thread_args.rate_controller = send_thread_args.rate_controller;
 
     pthread_create(&log_handler_thread, nullptr, log_handler_thread_f, &ping_logger);
     pthread_create(&writer_thread,      nullptr, writer_thread_f, &writer_thread_args);
-    pthread_create(&recv_thread,        nullptr, recv_thread_f,   &ping_logger);
+    pthread_create(&recv_thread,        nullptr, recv_thread_f,   &recv_thread_args);
     pthread_create(&send_thread,        nullptr, send_thread_f,   &send_thread_args);
 
     while('q' != getchar()) {}
@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "pingo.hpp"
+#include "prefix_scheduler.hpp"
+
+using namespace sandor_laboratories::pingo;
+
+#define PREFIX_SCHEDULER_SLASH_24_PER_SLASH_16 256U
+
+static timestamp_ns_t cap_interval(unsigned int max_rate)
+{
+  return ((max_rate > 0)?(TIMESTAMP_NS_PER_S/max_rate):0);
+}
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+prefix_scheduler_c::prefix_scheduler_c(uint32_t first_address, uint_fast64_t first_offset, uint_fast64_t end_offset,
+                                       const prefix_scheduler_config_s *init_config)
+  : first_address(first_address),
+    interval_24(cap_interval(init_config->max_rate_24)), interval_16(cap_interval(init_config->max_rate_16))
+{
+  const uint_fast64_t  first_scheduled = (uint_fast64_t)first_address + first_offset;
+  const uint_fast64_t  end_scheduled   = (uint_fast64_t)first_address + end_offset;
+  std::vector<unsigned int> order;
+
+  memset(&stats, 0, sizeof(stats));
+  now            = 0;
+  active         = 0;
+  current        = 0;
+  first_slash_24 = (uint32_t)(first_scheduled >> PREFIX_SCHEDULER_SLASH_24_SHIFT);
+  first_slash_16 = (uint32_t)(first_scheduled >> PREFIX_SCHEDULER_SLASH_16_SHIFT);
+
+  if(end_offset > first_offset)
+  {
+    slash_24.resize(((end_scheduled-1) >> PREFIX_SCHEDULER_SLASH_24_SHIFT) - first_slash_24 + 1);
+    slash_16_ready_time.assign(((end_scheduled-1) >> PREFIX_SCHEDULER_SLASH_16_SHIFT) - first_slash_16 + 1, 0);
+
+    for(unsigned int i = 0; i < slash_24.size(); i++)
+    {
+      const uint_fast64_t slash_24_first = MAX(first_scheduled, ((uint_fast64_t)(first_slash_24+i) << PREFIX_SCHEDULER_SLASH_24_SHIFT));
+      const uint_fast64_t slash_24_end   = MIN(end_scheduled, ((uint_fast64_t)(first_slash_24+i+1) << PREFIX_SCHEDULER_SLASH_24_SHIFT));
+
+      slash_24[i].offset     = (slash_24_first - first_address);
+      slash_24[i].end_offset = (slash_24_end - first_address);
+      slash_24[i].slash_16   = (unsigned int)(((first_slash_24+i) >> (PREFIX_SCHEDULER_SLASH_16_SHIFT-PREFIX_SCHEDULER_SLASH_24_SHIFT)) - first_slash_16);
+      slash_24[i].deferred   = false;
+      slash_24[i].ready_time = 0;
+      order.push_back(i);
+    }
+
+    /* Round robin takes the n-th /24 of every /16 before the n+1-th of any, so consecutive pings also change /16 */
+    std::stable_sort(order.begin(), order.end(), [this](unsigned int a, unsigned int b)
+      {
+        return (((first_slash_24+a) % PREFIX_SCHEDULER_SLASH_24_PER_SLASH_16) < ((first_slash_24+b) % PREFIX_SCHEDULER_SLASH_24_PER_SLASH_16));
+      });
+    for(unsigned int i = 0; i < order.size(); i++)
+    {
+      slash_24[order[i]].next     = order[(i+1) % order.size()];
+      slash_24[order[i]].previous = order[(i+order.size()-1) % order.size()];
+    }
+
+    active  = (unsigned int) order.size();
+    current = order[0];
+  }
+}
+
+void prefix_scheduler_c::remove(unsigned int index)
+{
+  slash_24[slash_24[index].previous].next = slash_24[index].next;
+  slash_24[slash_24[index].next].previous = slash_24[index].previous;
+  active--;
+}
+
+prefix_scheduler_next_e prefix_scheduler_c::next(uint_fast64_t *offset, timestamp_ns_t *ready_time)
+{
+  prefix_scheduler_next_e ret_val = PREFIX_SCHEDULER_DONE;
+  timestamp_ns_t          first_ready_time = 0;
+  slash_24_s             *candidate;
+
+  assert(offset != nullptr);
+  assert(ready_time != nullptr);
+
+  now = get_timestamp_ns();
+
+  for(unsigned int checked = 0; (PREFIX_SCHEDULER_DONE == ret_val) && (checked < active); checked++)
+  {
+    candidate = &slash_24[current];
+
+    if( (candidate->ready_time <= now) && (slash_16_ready_time[candidate->slash_16] <= now) )
+    {
+      *offset = candidate->offset;
+      candidate->offset++;
+      candidate->deferred = false;
+      if(candidate->offset >= candidate->end_offset)
+      {
+        remove(current);
+      }
+      ret_val = PREFIX_SCHEDULER_READY;
+    }
+    else
+    {
+      /* Each ping counts once, when its turn comes, against the first cap holding it back */
+      if((0 == checked) && !candidate->deferred)
+      {
+        candidate->deferred = true;
+        if(candidate->ready_time > now)
+        {
+          stats.deferred_24++;
+        }
+        else
+        {
+          stats.deferred_16++;
+        }
+      }
+      const timestamp_ns_t candidate_ready_time = MAX(candidate->ready_time, slash_16_ready_time[candidate->slash_16]);
+      first_ready_time = (0 == checked)?candidate_ready_time:MIN(first_ready_time, candidate_ready_time);
+    }
+    current = candidate->next;
+  }
+
+  if((PREFIX_SCHEDULER_DONE == ret_val) && (active > 0))
+  {
+    *ready_time = first_ready_time;
+    ret_val     = PREFIX_SCHEDULER_WAIT;
+  }
+
+  return ret_val;
+}
+
+void prefix_scheduler_c::sent(uint_fast64_t offset)
+{
+  const unsigned int index = (unsigned int)((((uint_fast64_t)first_address + offset) >> PREFIX_SCHEDULER_SLASH_24_SHIFT) - first_slash_24);
+
+  assert(index < slash_24.size());
+
+  /* Spaced from when the prefix opened rather than now, so oversleeping a wait does not lower the rate */
+  if(interval_24 > 0)
+  {
+    slash_24[index].ready_time = (MAX(now-interval_24, slash_24[index].ready_time) + interval_24);
+  }
+  if(interval_16 > 0)
+  {
+    slash_16_ready_time[slash_24[index].slash_16] = (MAX(now-interval_16, slash_16_ready_time[slash_24[index].slash_16]) + interval_16);
+  }
+}
+
+void prefix_scheduler_c::waited(timestamp_ns_t wait_ns)
+{
+  stats.waits++;
+  stats.wait_ns += wait_ns;
+}
@@ -0,0 +1,31 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <sys/random.h>
+
+#include "probe_cookie.hpp"
+
+using namespace sandor_laboratories::pingo;
+
+bool sandor_laboratories::pingo::init_probe_cookie_key(probe_cookie_key_s * key)
+{
+  bool ret_val = false;
+
+  if(key != nullptr)
+  {
+    if(sizeof(*key) == getrandom(key, sizeof(*key), 0))
+    {
+      ret_val = true;
+    }
+    else
+    {
+      fprintf(stderr, "Failed to generate probe cookie key.  errno %u: %s\n", errno, strerror(errno));
+    }
+  }
+  else
+  {
+    fprintf(stderr, "Null probe cookie key passed\n");
+  }
+
+  return ret_val;
+}
@@ -0,0 +1,155 @@
+#include <cassert>
+#include <cstdio>
+
+#include "pingo.hpp"
+#include "rate_controller.hpp"
+
+using namespace sandor_laboratories::pingo;
+
+/* Clean ping blocks needed to climb from min_rate to max_rate */
+#define RATE_CONTROLLER_INCREASE_STEPS 64
+#define RATE_CONTROLLER_PPM            1000000UL
+/* Running average yield weights each new ping block 1/2^shift */
+#define RATE_CONTROLLER_YIELD_AVERAGE_SHIFT 3
+
+// NOLINTBEGIN(readability-magic-numbers)
+void rate_controller_c::init_config(rate_controller_config_s *new_config, uint_fast64_t min_rate, uint_fast64_t max_rate)
+{
+  assert(new_config != nullptr);
+
+  new_config->min_rate           = MAX(1UL, min_rate);
+  new_config->max_rate           = MAX(new_config->min_rate, max_rate);
+  new_config->increase           = MAX(1UL, ((new_config->max_rate-new_config->min_rate)/RATE_CONTROLLER_INCREASE_STEPS));
+  new_config->decrease_percent   = 75;
+  new_config->send_error_percent = 1;
+  new_config->yield_drop_percent = 50;
+}
+// NOLINTEND(readability-magic-numbers)
+
+inline void rate_controller_c::lock()
+{
+  assert(0 == pthread_mutex_lock(&mutex));
+}
+inline void rate_controller_c::unlock()
+{
+  assert(0 == pthread_mutex_unlock(&mutex));
+}
+
+rate_controller_c::rate_controller_c(uint_fast64_t initial_rate, const rate_controller_config_s *init_config)
+  : config(*init_config)
+{
+  assert(0 == pthread_mutex_init(&mutex, NULL));
+
+  rate              = clamp(initial_rate);
+  average_yield_ppm = 0;
+}
+
+rate_controller_c::~rate_controller_c()
+{
+  assert(0 == pthread_mutex_destroy(&mutex));
+}
+
+inline uint_fast64_t rate_controller_c::clamp(uint_fast64_t clamp_rate) const
+{
+  return MAX(config.min_rate, MIN(clamp_rate, config.max_rate));
+}
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+rate_controller_action_e rate_controller_c::dispatch_feedback(unsigned int pings_sent, unsigned int send_retries, unsigned int send_drops)
+{
+  rate_controller_action_e ret_val = RATE_CONTROLLER_ACTION_HOLD;
+  const uint_fast64_t      send_errors = ((uint_fast64_t)send_retries + send_drops);
+
+  lock();
+  if((send_errors*PERCENT_100) > (((uint_fast64_t)pings_sent)*config.send_error_percent))
+  {
+    rate    = clamp((rate*config.decrease_percent)/PERCENT_100);
+    ret_val = RATE_CONTROLLER_ACTION_DECREASE_SEND_ERRORS;
+  }
+  else if(pings_sent > 0)
+  {
+    ret_val = ((rate < config.max_rate)?RATE_CONTROLLER_ACTION_INCREASE:RATE_CONTROLLER_ACTION_HOLD);
+    rate    = clamp(rate + config.increase);
+  }
+  unlock();
+
+  return ret_val;
+}
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+rate_controller_action_e rate_controller_c::yield_feedback(unsigned int pinged_addresses, unsigned int valid_replies)
+{
+  rate_controller_action_e ret_val = RATE_CONTROLLER_ACTION_HOLD;
+  uint_fast64_t            yield_ppm;
+
+  if(pinged_addresses > 0)
+  {
+    yield_ppm = (((uint_fast64_t)valid_replies)*RATE_CONTROLLER_PPM)/pinged_addresses;
+
+    lock();
+    if(0 == average_yield_ppm)
+    {
+      average_yield_ppm = yield_ppm;
+    }
+    else
+    {
+      /* Yield differs between address ranges, only a fall well below the running average is taken as upstream loss */
+      if((yield_ppm*PERCENT_100) < (average_yield_ppm*config.yield_drop_percent))
+      {
+        rate    = clamp((rate*config.decrease_percent)/PERCENT_100);
+        ret_val = RATE_CONTROLLER_ACTION_DECREASE_YIELD;
+      }
+      average_yield_ppm = average_yield_ppm - (average_yield_ppm >> RATE_CONTROLLER_YIELD_AVERAGE_SHIFT)
+                                            + (yield_ppm >> RATE_CONTROLLER_YIELD_AVERAGE_SHIFT);
+    }
+    unlock();
+  }
+
+  return ret_val;
+}
+
+uint_fast64_t rate_controller_c::get_rate()
+{
+  uint_fast64_t ret_val;
+
+  lock();
+  ret_val = rate;
+  unlock();
+
+  return ret_val;
+}
+
+const char * rate_controller_c::action_string(rate_controller_action_e action)
+{
+  const char * ret_val = "unknown";
+
+  switch(action)
+  {
+    case RATE_CONTROLLER_ACTION_HOLD:
+    {
+      ret_val = "held";
+      break;
+    }
+    case RATE_CONTROLLER_ACTION_INCREASE:
+    {
+      ret_val = "increased";
+      break;
+    }
+    case RATE_CONTROLLER_ACTION_DECREASE_SEND_ERRORS:
+    {
+      ret_val = "decreased after send errors";
+      break;
+    }
+    case RATE_CONTROLLER_ACTION_DECREASE_YIELD:
+    {
+      ret_val = "decreased after reply yield fell";
+      break;
+    }
+    default:
+    {
+      break;
+    }
+  }
+
+  return ret_val;
+}
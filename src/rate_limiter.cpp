@@ -0,0 +1,101 @@
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include "rate_limiter.hpp"
+
+using namespace sandor_laboratories::pingo;
+
+inline void rate_limiter_c::lock()
+{
+  assert(0 == pthread_mutex_lock(&mutex));
+}
+inline void rate_limiter_c::unlock()
+{
+  assert(0 == pthread_mutex_unlock(&mutex));
+}
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+rate_limiter_c::rate_limiter_c(uint_fast64_t rate, unsigned int burst)
+  : rate((rate > 0)?rate:1), burst((burst > 0)?burst:1)
+{
+  assert(0 == pthread_mutex_init(&mutex, NULL));
+
+  next_token_time      = get_time_ns();
+  next_token_remainder = 0;
+}
+
+rate_limiter_c::~rate_limiter_c()
+{
+  assert(0 == pthread_mutex_destroy(&mutex));
+}
+
+inline rate_limiter_ns_t rate_limiter_c::get_time_ns()
+{
+  struct timespec time_now;
+
+  clock_gettime(CLOCK_MONOTONIC, &time_now);
+
+  return ((((rate_limiter_ns_t)time_now.tv_sec)*RATE_LIMITER_NS_PER_SECOND) + time_now.tv_nsec);
+}
+
+void rate_limiter_c::acquire(unsigned int count)
+{
+  const rate_limiter_ns_t time_now = get_time_ns();
+  rate_limiter_ns_t       deadline;
+  rate_limiter_ns_t       burst_time;
+  uint_fast64_t           token_time;
+  struct timespec         deadline_timespec;
+  int                     sleep_code;
+
+  lock();
+
+  /* Idle time only earns up to one burst of tokens */
+  burst_time = (burst*RATE_LIMITER_NS_PER_SECOND)/rate;
+  if((next_token_time + burst_time) < time_now)
+  {
+    next_token_time      = time_now - burst_time;
+    next_token_remainder = 0;
+  }
+
+  /* Reserve tokens.  Remainder is carried so rates which do not divide 1s evenly do not drift */
+  deadline              = next_token_time;
+  token_time            = (count*RATE_LIMITER_NS_PER_SECOND) + next_token_remainder;
+  next_token_time      += token_time/rate;
+  next_token_remainder  = token_time%rate;
+
+  unlock();
+
+  if(deadline > time_now)
+  {
+    deadline_timespec.tv_sec  = (time_t)(deadline/RATE_LIMITER_NS_PER_SECOND);
+    deadline_timespec.tv_nsec = (long)  (deadline%RATE_LIMITER_NS_PER_SECOND);
+
+    while(EINTR == (sleep_code = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline_timespec, nullptr))) {}
+
+    if(0 != sleep_code)
+    {
+      fprintf(stderr, "Failed to sleep until rate limiter deadline.  error %d: %s\n", sleep_code, strerror(sleep_code));
+    }
+  }
+}
+
+uint_fast64_t rate_limiter_c::get_rate()
+{
+  uint_fast64_t ret_val;
+
+  lock();
+  ret_val = rate;
+  unlock();
+
+  return ret_val;
+}
+
+void rate_limiter_c::set_rate(uint_fast64_t new_rate)
+{
+  lock();
+  rate                 = ((new_rate > 0)?new_rate:1);
+  next_token_remainder = 0;
+  unlock();
+}
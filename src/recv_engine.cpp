@@ -0,0 +1,129 @@
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+
+#include "pingo.hpp"
+#include "recv_engine.hpp"
+
+using namespace sandor_laboratories::pingo;
+
+void recv_engine_c::init_config(recv_engine_config_s *config)
+{
+  assert(config != nullptr);
+
+  memset(config, 0, sizeof(recv_engine_config_s));
+  config->batch_size = RECV_ENGINE_DEFAULT_BATCH_SIZE;
+  config->xdp_socket = nullptr;
+  config->timeout_ms = 0;
+}
+
+recv_engine_c::recv_engine_c(int sockfd, const recv_engine_config_s *init_config)
+  : sockfd(sockfd), config(*init_config)
+{
+  const unsigned int batch_size = ((config.batch_size > 0)?config.batch_size:1);
+
+  memset(&stats, 0, sizeof(stats));
+  received = 0;
+
+  msg.resize(batch_size);
+  iov.resize(batch_size);
+  src_addr.resize(batch_size);
+  buffer.resize(batch_size*RECV_ENGINE_SLOT_SIZE_WORDS);
+  control.resize(batch_size*RECV_ENGINE_CONTROL_SIZE_BYTES);
+
+  memset(msg.data(), 0, sizeof(struct mmsghdr)*batch_size);
+
+  for(unsigned int i = 0; i < batch_size; i++)
+  {
+    iov[i].iov_base = &buffer[i*RECV_ENGINE_SLOT_SIZE_WORDS];
+    iov[i].iov_len  = RECV_ENGINE_SLOT_SIZE_BYTES;
+
+    msg[i].msg_hdr.msg_name    = &src_addr[i];
+    msg[i].msg_hdr.msg_iov     = &iov[i];
+    msg[i].msg_hdr.msg_iovlen  = 1;
+    msg[i].msg_hdr.msg_control = &control[i*RECV_ENGINE_CONTROL_SIZE_BYTES];
+  }
+}
+
+int recv_engine_c::receive()
+{
+  int ret_val;
+
+  if(config.xdp_socket != nullptr)
+  {
+    ret_val = receive_xdp();
+  }
+  else
+  {
+    /* Kernel shrinks the name and control lengths to what it wrote for every message */
+    for(unsigned int i = 0; i < msg.size(); i++)
+    {
+      msg[i].msg_hdr.msg_namelen    = sizeof(struct sockaddr_in);
+      msg[i].msg_hdr.msg_controllen = RECV_ENGINE_CONTROL_SIZE_BYTES;
+      msg[i].msg_hdr.msg_flags      = 0;
+    }
+
+    /* Blocks up to SO_RCVTIMEO for the first packet, then takes only those already waiting */
+    ret_val = recvmmsg(sockfd, msg.data(), (unsigned int)msg.size(), MSG_WAITFORONE, nullptr);
+  }
+
+  received = ((ret_val > 0)?(unsigned int)ret_val:0);
+  if(ret_val > 0)
+  {
+    stats.batches++;
+    stats.packets += (unsigned int)ret_val;
+  }
+
+  return ret_val;
+}
+
+int recv_engine_c::receive_xdp()
+{
+  int     ret_val = 0;
+  ssize_t recv_bytes;
+
+  /* Waits for the first reply only, then drains what the RX ring already holds */
+  for(unsigned int i = 0; i < msg.size(); i++)
+  {
+    recv_bytes = config.xdp_socket->receive(&buffer[i*RECV_ENGINE_SLOT_SIZE_WORDS], RECV_ENGINE_SLOT_SIZE_BYTES, &src_addr[i],
+                                            ((0 == i)?config.timeout_ms:0));
+    if(-1 == recv_bytes)
+    {
+      ret_val = ((0 == i)?-1:ret_val);
+      break;
+    }
+
+    msg[i].msg_len                = (unsigned int)recv_bytes;
+    msg[i].msg_hdr.msg_namelen    = sizeof(struct sockaddr_in);
+    msg[i].msg_hdr.msg_controllen = 0;
+    ret_val++;
+  }
+
+  return ret_val;
+}
+
+recv_engine_packet_s recv_engine_c::get_packet(unsigned int i) const
+{
+  recv_engine_packet_s ret_val;
+
+  assert(i < received);
+
+  ret_val.buffer   = &buffer[i*RECV_ENGINE_SLOT_SIZE_WORDS];
+  ret_val.size     = msg[i].msg_len;
+  ret_val.src_addr = &src_addr[i];
+  ret_val.addrlen  = msg[i].msg_hdr.msg_namelen;
+  ret_val.rx_time  = 0;
+
+  /* Replies are stamped by the kernel on arrival, so time spent queued on the socket is not counted */
+  for(const struct cmsghdr *control_msg = CMSG_FIRSTHDR(&msg[i].msg_hdr); control_msg != nullptr;
+      control_msg = CMSG_NXTHDR((struct msghdr*)&msg[i].msg_hdr, (struct cmsghdr*)control_msg))
+  {
+    if((SOL_SOCKET == control_msg->cmsg_level) && (SCM_TIMESTAMPNS == control_msg->cmsg_type))
+    {
+      ret_val.rx_time = timestamp_from_realtime((const struct timespec*) CMSG_DATA(control_msg));
+    }
+  }
+
+  return ret_val;
+}
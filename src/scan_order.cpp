@@ -0,0 +1,166 @@
+#include <cassert>
+#include <cstdio>
+
+#include "scan_order.hpp"
+
+using namespace sandor_laboratories::pingo;
+
+/* splitmix64 finalizer to spread seeds over the group */
+inline uint_fast64_t mix_seed(uint_fast64_t seed)
+{
+  // NOLINTBEGIN(readability-magic-numbers)
+  uint64_t z = (seed + 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return (z ^ (z >> 31));
+  // NOLINTEND(readability-magic-numbers)
+}
+
+inline uint_fast64_t scan_order_c::mul_mod(uint_fast64_t a, uint_fast64_t b, uint_fast64_t modulus)
+{
+  /* Modulus may exceed 32 bits for a full IPv4 address space (2^32+15) */
+  return (uint_fast64_t)((((unsigned __int128)a)*b)%modulus);
+}
+
+uint_fast64_t scan_order_c::pow_mod(uint_fast64_t base, uint_fast64_t exponent, uint_fast64_t modulus)
+{
+  uint_fast64_t result = (1%modulus);
+
+  base %= modulus;
+  while(exponent > 0)
+  {
+    if(exponent & 1)
+    {
+      result = mul_mod(result, base, modulus);
+    }
+    base = mul_mod(base, base, modulus);
+    exponent >>= 1;
+  }
+
+  return result;
+}
+
+bool scan_order_c::is_prime(uint_fast64_t n)
+{
+  bool ret_val = (n >= 2);
+
+  if(n >= 4)
+  {
+    ret_val = ((n % 2) != 0);
+    for(uint_fast64_t i = 3; ret_val && ((i*i) <= n); i += 2)
+    {
+      ret_val = ((n % i) != 0);
+    }
+  }
+
+  return ret_val;
+}
+
+bool scan_order_c::is_generator(uint_fast64_t g, uint_fast64_t p)
+{
+  bool          ret_val = ((g % p) != 0);
+  uint_fast64_t remaining = (p-1);
+
+  /* g generates the group if g^((p-1)/q) != 1 for every prime factor q of p-1 */
+  for(uint_fast64_t q = 2; ret_val && ((q*q) <= remaining); q++)
+  {
+    if((remaining % q) == 0)
+    {
+      ret_val = (pow_mod(g, (p-1)/q, p) != 1);
+      while((remaining % q) == 0)
+      {
+        remaining /= q;
+      }
+    }
+  }
+  if(ret_val && (remaining > 1))
+  {
+    ret_val = (pow_mod(g, (p-1)/remaining, p) != 1);
+  }
+
+  return ret_val;
+}
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+scan_order_c::scan_order_c(scan_order_e order, uint_fast64_t count, uint_fast64_t seed)
+  : order(order), count(count)
+{
+  prime         = 0;
+  generator     = 1;
+  first_element = 0;
+  element       = 0;
+  position      = 0;
+
+  if(SCAN_ORDER_PERMUTED == order)
+  {
+    /* Group elements 1..p-1 map to offsets 0..p-2 */
+    prime = (count+1);
+    while(!is_prime(prime))
+    {
+      prime++;
+    }
+
+    if(prime > 3)
+    {
+      generator = 2 + (mix_seed(seed) % (prime-3));
+      while(!is_generator(generator, prime))
+      {
+        generator = (generator < (prime-2))?(generator+1):2;
+      }
+    }
+    else
+    {
+      generator = (prime-1);
+    }
+
+    first_element = 1 + (mix_seed(~seed) % (prime-1));
+  }
+
+  seek(0);
+}
+
+scan_order_position_t scan_order_c::get_positions() const
+{
+  return ((SCAN_ORDER_PERMUTED == order)?(prime-1):count);
+}
+
+void scan_order_c::seek(scan_order_position_t new_position)
+{
+  position = new_position;
+
+  if(SCAN_ORDER_PERMUTED == order)
+  {
+    element = mul_mod(first_element, pow_mod(generator, position, prime), prime);
+  }
+}
+
+bool scan_order_c::next(uint_fast64_t * offset, scan_order_position_t end_position)
+{
+  bool ret_val = false;
+
+  assert(offset != nullptr);
+
+  end_position = ((end_position < get_positions())?end_position:get_positions());
+
+  if(SCAN_ORDER_PERMUTED == order)
+  {
+    while(!ret_val && (position < end_position))
+    {
+      if((element-1) < count)
+      {
+        *offset = (element-1);
+        ret_val = true;
+      }
+      element = mul_mod(element, generator, prime);
+      position++;
+    }
+  }
+  else if(position < end_position)
+  {
+    *offset = position;
+    position++;
+    ret_val = true;
+  }
+
+  return ret_val;
+}
\ No newline at end of file
@@ -0,0 +1,672 @@
+#include <arpa/inet.h>
+#include <cassert>
+#include <cstddef>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#include <net/if.h>
+#include <netinet/ip.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "pingo.hpp"
+#include "send_engine.hpp"
+
+using namespace sandor_laboratories::pingo;
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+send_engine_c::send_engine_c(int sockfd, const send_engine_config_s *init_config, send_engine_drop_cb drop_cb, void * drop_cb_user_data_ptr)
+  : sockfd(sockfd), config(*init_config), drop_cb(drop_cb), drop_cb_user_data_ptr(drop_cb_user_data_ptr),
+    tx_timestamp_cb(nullptr), tx_timestamp_cb_user_data_ptr(nullptr)
+{
+  const unsigned int batch_size = ((config.batch_size > 0)?config.batch_size:1);
+
+  queued                  = 0;
+  slot_head               = 0;
+  memset(&stats, 0, sizeof(stats));
+  ring                    = nullptr;
+  ring_size               = 0;
+  source_address          = 0;
+  packet_header_size      = 0;
+  packet_header_icmp_size = 0;
+  memset(packet_header, 0, sizeof(packet_header));
+  xdp_frames              = 0;
+
+  dest.resize(batch_size);
+  memset(dest.data(), 0, sizeof(struct sockaddr_in)*batch_size);
+
+  if(SEND_ENGINE_BACKEND_PACKET_MMAP == config.backend)
+  {
+    init_packet_ring();
+  }
+  else if(SEND_ENGINE_BACKEND_AF_XDP == config.backend)
+  {
+    init_xdp_frames();
+  }
+  else
+  {
+    if(SEND_ENGINE_BACKEND_IP_HDRINCL == config.backend)
+    {
+      /* Kernel fills in the source address of a zero source */
+      packet_header_size = SEND_ENGINE_IPV4_HEADER_SIZE_BYTES;
+    }
+
+    msg.resize(batch_size);
+    iov.resize(batch_size);
+    buffer.resize(batch_size*(packet_header_size+SEND_ENGINE_SLOT_SIZE_BYTES));
+    slot_buffer.resize(batch_size);
+
+    memset(msg.data(),  0, sizeof(struct mmsghdr)*batch_size);
+
+    for(unsigned int i = 0; i < batch_size; i++)
+    {
+      dest[i].sin_family = AF_INET;
+      dest[i].sin_port   = htons(IPPROTO_ICMP);
+
+      slot_buffer[i]  = &buffer[(i*(packet_header_size+SEND_ENGINE_SLOT_SIZE_BYTES))+packet_header_size];
+      iov[i].iov_base = (slot_buffer[i]-packet_header_size);
+      iov[i].iov_len  = 0;
+
+      msg[i].msg_hdr.msg_name    = &dest[i];
+      msg[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+      msg[i].msg_hdr.msg_iov     = &iov[i];
+      msg[i].msg_hdr.msg_iovlen  = 1;
+    }
+
+    if(config.tx_timestamps)
+    {
+      init_tx_timestamps();
+    }
+  }
+}
+
+send_engine_c::~send_engine_c()
+{
+  struct tpacket_req ring_request;
+
+  if(ring != nullptr)
+  {
+    /* Release the ring so another engine may map a new one on the same socket */
+    munmap(ring, ring_size);
+    memset(&ring_request, 0, sizeof(ring_request));
+    if(0 != setsockopt(sockfd, SOL_PACKET, PACKET_TX_RING, &ring_request, sizeof(ring_request)))
+    {
+      fprintf(stderr, "Failed to release PACKET_MMAP TX ring.  errno %u: %s\n", errno, strerror(errno));
+    }
+  }
+}
+
+void send_engine_c::init_packet_ring()
+{
+  const unsigned int  batch_size   = ((config.batch_size > 0)?config.batch_size:1);
+  const size_t        data_offset  = (TPACKET2_HDRLEN - sizeof(struct sockaddr_ll));
+  const size_t        block_size   = (size_t)sysconf(_SC_PAGESIZE);
+  const size_t        frame_size   = TPACKET_ALIGN(data_offset + SEND_ENGINE_FRAME_HEADER_SIZE_BYTES + SEND_ENGINE_SLOT_SIZE_BYTES);
+  const unsigned int  frames_per_block = (unsigned int)(block_size/frame_size);
+  const int           version      = TPACKET_V2;
+  /* Malformed frames are discarded instead of stalling the ring */
+  const int           discard_malformed = 1;
+  struct tpacket_req  ring_request;
+  struct sockaddr_ll  link_address;
+  socklen_t           link_address_size = sizeof(link_address);
+  struct ifreq        interface_request;
+
+  memset(&link_address, 0, sizeof(link_address));
+  memset(&interface_request, 0, sizeof(interface_request));
+
+  /* Source MAC and IPv4 address come from the interface the socket is bound to */
+  if( (0 != getsockname(sockfd, (struct sockaddr*) &link_address, &link_address_size)) ||
+      (link_address.sll_halen != ETHER_ADDR_LEN) ||
+      (nullptr == if_indextoname(link_address.sll_ifindex, interface_request.ifr_name)) ||
+      (0 != ioctl(sockfd, SIOCGIFADDR, &interface_request)) )
+  {
+    fprintf(stderr, "Failed to find Ethernet and IPv4 address of PACKET_MMAP send interface.  errno %u: %s\n", errno, strerror(errno));
+    safe_exit(1);
+  }
+  source_address = ntohl(((struct sockaddr_in*) &interface_request.ifr_addr)->sin_addr.s_addr);
+
+  init_ethernet_header(link_address.sll_addr);
+
+  memset(&ring_request, 0, sizeof(ring_request));
+  ring_request.tp_block_size = block_size;
+  ring_request.tp_block_nr   = ((batch_size+frames_per_block-1)/frames_per_block);
+  ring_request.tp_frame_size = frame_size;
+  ring_request.tp_frame_nr   = (ring_request.tp_block_nr*frames_per_block);
+  ring_size                  = (ring_request.tp_block_size*ring_request.tp_block_nr);
+
+  if( (0 != setsockopt(sockfd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version))) ||
+      (0 != setsockopt(sockfd, SOL_PACKET, PACKET_LOSS, &discard_malformed, sizeof(discard_malformed))) ||
+      (0 != setsockopt(sockfd, SOL_PACKET, PACKET_TX_RING, &ring_request, sizeof(ring_request))) )
+  {
+    fprintf(stderr, "Failed to configure PACKET_MMAP TX ring.  errno %u: %s\n", errno, strerror(errno));
+    safe_exit(1);
+  }
+
+  ring = (uint8_t*) mmap(nullptr, ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, sockfd, 0);
+  if(MAP_FAILED == ring)
+  {
+    fprintf(stderr, "Failed to map PACKET_MMAP TX ring.  errno %u: %s\n", errno, strerror(errno));
+    ring = nullptr;
+    safe_exit(1);
+  }
+
+  frame.resize(ring_request.tp_frame_nr);
+  slot_buffer.resize(ring_request.tp_frame_nr);
+  for(unsigned int i = 0; i < ring_request.tp_frame_nr; i++)
+  {
+    frame[i]       = (struct tpacket2_hdr*) &ring[((i/frames_per_block)*block_size) + ((i%frames_per_block)*frame_size)];
+    slot_buffer[i] = &((uint8_t*) frame[i])[data_offset + SEND_ENGINE_FRAME_HEADER_SIZE_BYTES];
+  }
+}
+
+void send_engine_c::init_xdp_frames()
+{
+  const unsigned int batch_size = ((config.batch_size > 0)?config.batch_size:1);
+
+  assert(config.xdp_socket != nullptr);
+  assert(config.xdp_socket->get_fd() == sockfd);
+
+  source_address = config.xdp_socket->get_source_address();
+  init_ethernet_header(config.xdp_socket->get_source_mac());
+
+  /* Every batch waits for its frames to complete, so one frame per slot is enough */
+  xdp_frames = config.xdp_socket->allocate_tx_frames(batch_size);
+  iov.resize(batch_size);
+  slot_buffer.resize(batch_size);
+  for(unsigned int i = 0; i < batch_size; i++)
+  {
+    iov[i].iov_base = config.xdp_socket->get_frame(xdp_frames + ((uint64_t)i*XDP_SOCKET_FRAME_SIZE_BYTES));
+    iov[i].iov_len  = 0;
+    slot_buffer[i]  = &((uint8_t*) iov[i].iov_base)[SEND_ENGINE_FRAME_HEADER_SIZE_BYTES];
+  }
+}
+
+void send_engine_c::init_ethernet_header(const uint8_t *source_mac)
+{
+  struct ether_header ethernet_header;
+
+  memcpy(ethernet_header.ether_dhost, config.gateway_mac, ETHER_ADDR_LEN);
+  memcpy(ethernet_header.ether_shost, source_mac, ETHER_ADDR_LEN);
+  ethernet_header.ether_type = htons(ETHERTYPE_IP);
+  memcpy(packet_header, &ethernet_header, sizeof(ethernet_header));
+  packet_header_size = SEND_ENGINE_FRAME_HEADER_SIZE_BYTES;
+}
+
+void send_engine_c::init_tx_timestamps()
+{
+  const unsigned int batch_size = ((config.batch_size > 0)?config.batch_size:1);
+
+  tx_timestamp_msg.resize(batch_size);
+  tx_timestamp_iov.resize(batch_size);
+  tx_timestamp_buffer.resize(batch_size*SEND_ENGINE_TX_TIMESTAMP_PACKET_SIZE_BYTES);
+  tx_timestamp_control.resize(batch_size*SEND_ENGINE_TX_TIMESTAMP_CONTROL_SIZE_BYTES);
+
+  memset(tx_timestamp_msg.data(), 0, sizeof(struct mmsghdr)*batch_size);
+
+  for(unsigned int i = 0; i < batch_size; i++)
+  {
+    tx_timestamp_iov[i].iov_base = &tx_timestamp_buffer[i*SEND_ENGINE_TX_TIMESTAMP_PACKET_SIZE_BYTES];
+    tx_timestamp_iov[i].iov_len  = SEND_ENGINE_TX_TIMESTAMP_PACKET_SIZE_BYTES;
+
+    tx_timestamp_msg[i].msg_hdr.msg_iov    = &tx_timestamp_iov[i];
+    tx_timestamp_msg[i].msg_hdr.msg_iovlen = 1;
+  }
+}
+
+void send_engine_c::build_packet_header(size_t icmp_packet_size)
+{
+  ipv4_packet_meta_s  ipv4_packet_meta;
+  ipv4_word_t         ipv4_buffer[IPV4_HEADER_FIXED_SIZE_WORDS+BYTE_SIZE_TO_IPV4_WORD_SIZE(SEND_ENGINE_SLOT_SIZE_BYTES)];
+  /* Payload is filled per packet, header encoding only needs its size */
+  const ipv4_word_t   empty_payload[BYTE_SIZE_TO_IPV4_WORD_SIZE(SEND_ENGINE_SLOT_SIZE_BYTES)] = {0};
+
+  memset(&ipv4_packet_meta, 0, sizeof(ipv4_packet_meta));
+  ipv4_packet_meta.header_valid        = true;
+  ipv4_packet_meta.header.version      = IPV4_VERSION;
+  ipv4_packet_meta.header.ihl          = IPV4_HEADER_FIXED_SIZE_WORDS;
+  ipv4_packet_meta.header.total_length = (uint16_t)(SEND_ENGINE_IPV4_HEADER_SIZE_BYTES + icmp_packet_size);
+  ipv4_packet_meta.header.flags        = IPV4_FLAG_DF;
+  ipv4_packet_meta.header.ttl          = (uint8_t) config.ttl;
+  ipv4_packet_meta.header.protocol     = IPPROTO_ICMP;
+  ipv4_packet_meta.header.source_ip    = source_address;
+  ipv4_packet_meta.header.dest_ip      = 0;
+  ipv4_packet_meta.payload.buffer      = empty_payload;
+  ipv4_packet_meta.payload.size        = icmp_packet_size;
+
+  if(0 == encode_ipv4_packet(&ipv4_packet_meta, ipv4_buffer, sizeof(ipv4_buffer)))
+  {
+    fprintf(stderr, "Failed to encode IPv4 header template for send engine.  icmp_packet_size %lu\n", icmp_packet_size);
+    safe_exit(1);
+  }
+
+  memcpy(&packet_header[packet_header_size-SEND_ENGINE_IPV4_HEADER_SIZE_BYTES], ipv4_buffer, SEND_ENGINE_IPV4_HEADER_SIZE_BYTES);
+  packet_header_icmp_size = icmp_packet_size;
+}
+
+bool send_engine_c::queue(uint32_t dest_address, size_t packet_size, uint16_t probe_id)
+{
+  bool            ret_val = true;
+  const unsigned  slot_index = ((slot_head+queued)%slot_buffer.size());
+  uint8_t        *ipv4_header;
+  uint32_t        dest_address_n;
+  uint16_t        dest_address_words[2];
+  uint16_t        identification_n;
+  uint16_t        checksum;
+
+  if((queued < dest.size()) && (packet_size <= SEND_ENGINE_SLOT_SIZE_BYTES))
+  {
+    dest[queued].sin_addr.s_addr = htonl(dest_address);
+
+    if(packet_header_size > 0)
+    {
+      if(packet_size != packet_header_icmp_size)
+      {
+        build_packet_header(packet_size);
+      }
+
+      /* Packet header is copied from the template, only the destination, identification and IPv4 checksum differ */
+      memcpy((slot_buffer[slot_index]-packet_header_size), packet_header, packet_header_size);
+      ipv4_header      = (slot_buffer[slot_index]-SEND_ENGINE_IPV4_HEADER_SIZE_BYTES);
+      dest_address_n   = htonl(dest_address);
+      identification_n = htons(probe_id);
+      memcpy(dest_address_words, &dest_address_n, sizeof(dest_address_words));
+      memcpy(&checksum, &ipv4_header[offsetof(struct iphdr, check)], sizeof(checksum));
+      checksum = update_ipv4_checksum(checksum, 0, dest_address_words[0]);
+      checksum = update_ipv4_checksum(checksum, 0, dest_address_words[1]);
+      checksum = update_ipv4_checksum(checksum, 0, identification_n);
+      memcpy(&ipv4_header[offsetof(struct iphdr, check)], &checksum, sizeof(checksum));
+      memcpy(&ipv4_header[offsetof(struct iphdr, daddr)], &dest_address_n, sizeof(dest_address_n));
+      memcpy(&ipv4_header[offsetof(struct iphdr, id)], &identification_n, sizeof(identification_n));
+    }
+
+    if(SEND_ENGINE_BACKEND_PACKET_MMAP == config.backend)
+    {
+      frame[slot_index]->tp_len = (packet_header_size + packet_size);
+    }
+    else
+    {
+      iov[queued].iov_len = (packet_header_size + packet_size);
+    }
+    queued++;
+  }
+  else
+  {
+    fprintf(stderr, "Failed to queue packet in send engine.  queued %u batch_size %lu packet_size %lu\n",
+            queued, dest.size(), packet_size);
+    ret_val = false;
+  }
+
+  return ret_val;
+}
+
+void send_engine_c::set_drop_cb(send_engine_drop_cb new_drop_cb, void * new_drop_cb_user_data_ptr)
+{
+  assert(is_empty());
+
+  drop_cb               = new_drop_cb;
+  drop_cb_user_data_ptr = new_drop_cb_user_data_ptr;
+}
+
+void send_engine_c::set_tx_timestamp_cb(send_engine_tx_timestamp_cb new_tx_timestamp_cb, void * new_tx_timestamp_cb_user_data_ptr)
+{
+  assert(is_empty());
+
+  tx_timestamp_cb               = new_tx_timestamp_cb;
+  tx_timestamp_cb_user_data_ptr = new_tx_timestamp_cb_user_data_ptr;
+}
+
+void send_engine_c::drop(unsigned int slot, int error)
+{
+  assert(slot < queued);
+
+  stats.drops++;
+
+  if(drop_cb != nullptr)
+  {
+    drop_cb(ntohl(dest[slot].sin_addr.s_addr), error, drop_cb_user_data_ptr);
+  }
+}
+
+bool send_engine_c::backoff(int error, unsigned int *remaining_attempts, struct timespec *backoff_time)
+{
+  bool          ret_val = (*remaining_attempts > 1);
+  struct pollfd writable;
+  uint_fast64_t backoff_ns;
+
+  /* Transient backpressure, back off briefly before the same packet is retried */
+  if(ret_val)
+  {
+    (*remaining_attempts)--;
+    stats.retries++;
+    if(EAGAIN == error)
+    {
+      /* Socket buffer is full, retry as soon as it drains */
+      writable.fd      = sockfd;
+      writable.events  = POLLOUT;
+      writable.revents = 0;
+      ppoll(&writable, 1, backoff_time, nullptr);
+    }
+    else
+    {
+      /* Device queue is full, which socket writability does not reflect */
+      nanosleep(backoff_time, nullptr);
+    }
+    backoff_ns = MIN((2*((((uint_fast64_t)backoff_time->tv_sec)*TIMESTAMP_NS_PER_S) + (uint_fast64_t)backoff_time->tv_nsec)), 
+                     (uint_fast64_t)SEND_ENGINE_MAX_BACKOFF_NS);
+    backoff_time->tv_sec  = (time_t)(backoff_ns/TIMESTAMP_NS_PER_S);
+    backoff_time->tv_nsec = (long)(backoff_ns%TIMESTAMP_NS_PER_S);
+  }
+
+  return ret_val;
+}
+
+unsigned int send_engine_c::flush_socket()
+{
+  unsigned int    sent = 0;
+  unsigned int    slot = 0;
+  unsigned int    remaining_attempts = config.send_attempts;
+  struct timespec backoff_time = config.backoff;
+  int             ret;
+
+  while(slot < queued)
+  {
+    ret = sendmmsg(sockfd, &msg[slot], (queued-slot), 0);
+
+    if(ret > 0)
+    {
+      /* Partial sends resume at the first unsent slot.  An error with that slot is reported by the next call */
+      slot += ret;
+      sent += ret;
+      remaining_attempts = config.send_attempts;
+      backoff_time = config.backoff;
+    }
+    else
+    {
+      switch(errno)
+      {
+        case EINTR:
+        {
+          break;
+        }
+        case EAGAIN:
+        case ENOBUFS:
+        {
+          if(backoff(errno, &remaining_attempts, &backoff_time))
+          {
+            break;
+          }
+          [[fallthrough]];
+        }
+        default:
+        {
+          drop(slot, errno);
+          slot++;
+          remaining_attempts = config.send_attempts;
+          backoff_time = config.backoff;
+          break;
+        }
+      }
+    }
+  }
+
+  return sent;
+}
+
+unsigned int send_engine_c::flush_packet_ring()
+{
+  unsigned int    sent = 0;
+  unsigned int    slot = 0;
+  unsigned int    remaining_attempts = config.send_attempts;
+  struct timespec backoff_time = config.backoff;
+  ssize_t         ret;
+  int             error;
+
+  /* Hand queued frames to the kernel.  Frame contents must be visible before the status changes */
+  for(unsigned int i = 0; i < queued; i++)
+  {
+    __atomic_store_n(&frame[(slot_head+i)%frame.size()]->tp_status, TP_STATUS_SEND_REQUEST, __ATOMIC_RELEASE);
+  }
+
+  while(slot < queued)
+  {
+    /* Blocking send transmits every pending frame and waits for the kernel to release them */
+    ret   = sendto(sockfd, nullptr, 0, 0, nullptr, 0);
+    error = errno;
+
+    /* Kernel consumes frames in order from the ring head and stops at the first frame it fails to send */
+    while( (slot < queued) && 
+           (TP_STATUS_SEND_REQUEST != __atomic_load_n(&frame[(slot_head+slot)%frame.size()]->tp_status, __ATOMIC_ACQUIRE)) )
+    {
+      slot++;
+      sent++;
+      remaining_attempts = config.send_attempts;
+      backoff_time = config.backoff;
+    }
+
+    if(slot < queued)
+    {
+      /* Kernel stopped short without reporting an error, treat it as backpressure */
+      if(ret >= 0)
+      {
+        error = EAGAIN;
+      }
+
+      switch(error)
+      {
+        case EINTR:
+        {
+          break;
+        }
+        case EAGAIN:
+        case ENOBUFS:
+        {
+          if(backoff(error, &remaining_attempts, &backoff_time))
+          {
+            break;
+          }
+          [[fallthrough]];
+        }
+        default:
+        {
+          /* Frames left at the kernel's ring head cannot be skipped individually.
+              Drop the rest of the batch and reuse the frames for the next one so the ring stays in step */
+          for(; slot < queued; slot++)
+          {
+            __atomic_store_n(&frame[(slot_head+slot)%frame.size()]->tp_status, TP_STATUS_AVAILABLE, __ATOMIC_RELEASE);
+            drop(slot, error);
+          }
+          break;
+        }
+      }
+    }
+  }
+
+  slot_head = ((slot_head+sent)%frame.size());
+
+  return sent;
+}
+
+unsigned int send_engine_c::flush_xdp()
+{
+  xdp_socket_c   *xdp_socket = config.xdp_socket;
+  unsigned int    submitted = 0;
+  unsigned int    sent = 0;
+  unsigned int    completed;
+  unsigned int    remaining_attempts = config.send_attempts;
+  struct timespec backoff_time = config.backoff;
+  int             error;
+
+  /* Completions are not tagged with their sender, so the TX ring holds one engine's batch at a time */
+  xdp_socket->lock_tx();
+  while(sent < queued)
+  {
+    while((submitted < queued) && 
+          xdp_socket->tx_queue((xdp_frames + ((uint64_t)submitted*XDP_SOCKET_FRAME_SIZE_BYTES)), (uint32_t)iov[submitted].iov_len))
+    {
+      submitted++;
+    }
+
+    error     = xdp_socket->tx_kick();
+    completed = xdp_socket->tx_complete();
+
+    if(completed > 0)
+    {
+      sent = MIN(queued, (sent+completed));
+      remaining_attempts = config.send_attempts;
+      backoff_time = config.backoff;
+    }
+    else if(EINTR != error)
+    {
+      /* Submitted frames cannot be taken back from the TX ring, so they are waited for instead of dropped */
+      if( ((0 != error) && (EAGAIN != error) && (EBUSY != error) && (ENOBUFS != error)) ||
+          !backoff(ENOBUFS, &remaining_attempts, &backoff_time) )
+      {
+        fprintf(stderr, "AF_XDP transmit stalled with %u of %u frames outstanding.  errno %u: %s\n", 
+                (queued-sent), queued, error, strerror(error));
+        safe_exit(1);
+      }
+    }
+  }
+  xdp_socket->unlock_tx();
+
+  return sent;
+}
+
+unsigned int send_engine_c::flush()
+{
+  unsigned int sent;
+
+  if(SEND_ENGINE_BACKEND_PACKET_MMAP == config.backend)
+  {
+    sent = flush_packet_ring();
+  }
+  else if(SEND_ENGINE_BACKEND_AF_XDP == config.backend)
+  {
+    sent = flush_xdp();
+  }
+  else
+  {
+    sent = flush_socket();
+  }
+
+  queued      = 0;
+  stats.sent += sent;
+
+  if(config.tx_timestamps)
+  {
+    read_tx_timestamps();
+  }
+
+  return sent;
+}
+
+void send_engine_c::tx_timestamp(struct msghdr *message, size_t packet_size)
+{
+  const struct scm_timestamping  *timestamping = nullptr;
+  const struct sock_extended_err *extended_error = nullptr;
+  const uint8_t                  *packet = (const uint8_t*) message->msg_iov->iov_base;
+  /* Devices without a link layer header, and Ethernet devices including loopback */
+  const size_t                    link_header_sizes[] = {0, sizeof(struct ether_header)};
+  size_t                          ipv4_offset = 0;
+  size_t                          ipv4_header_size = 0;
+  size_t                          ipv4_total_length = 0;
+  struct iphdr                    ipv4_header;
+  uint16_t                        header_word;
+  uint_fast32_t                   header_sum;
+  bool                            ipv4_found = false;
+
+  for(struct cmsghdr *control = CMSG_FIRSTHDR(message); control != nullptr; control = CMSG_NXTHDR(message, control))
+  {
+    if((SOL_SOCKET == control->cmsg_level) && (SCM_TIMESTAMPING == control->cmsg_type))
+    {
+      timestamping = (const struct scm_timestamping*) CMSG_DATA(control);
+    }
+    else if((SOL_IP == control->cmsg_level) && (IP_RECVERR == control->cmsg_type))
+    {
+      extended_error = (const struct sock_extended_err*) CMSG_DATA(control);
+    }
+  }
+
+  /* Software timestamp is ts[0], taken as the device transmits the packet */
+  if( (timestamping != nullptr) && (extended_error != nullptr) &&
+      (ENOMSG == extended_error->ee_errno) && (SO_EE_ORIGIN_TIMESTAMPING == extended_error->ee_origin) &&
+      ((timestamping->ts[0].tv_sec != 0) || (timestamping->ts[0].tv_nsec != 0)) &&
+      (0 == (message->msg_flags & MSG_TRUNC)) )
+  {
+    /* Looped packet starts at the link layer header, which depends on the device.
+        Drivers may pad short frames before stamping them, so the IPv4 header may end short of the packet.
+        It is told apart from link layer bytes by its header checksum */
+    for(unsigned int i = 0; (!ipv4_found) && (i < (sizeof(link_header_sizes)/sizeof(link_header_sizes[0]))); i++)
+    {
+      ipv4_offset = link_header_sizes[i];
+      if((ipv4_offset+sizeof(ipv4_header)) <= packet_size)
+      {
+        memcpy(&ipv4_header, &packet[ipv4_offset], sizeof(ipv4_header));
+        ipv4_header_size  = IPV4_WORD_SIZE_TO_BYTE_SIZE(ipv4_header.ihl);
+        ipv4_total_length = ntohs(ipv4_header.tot_len);
+        ipv4_found = ( (IPV4_VERSION == ipv4_header.version) && (ipv4_header.ihl >= IPV4_HEADER_FIXED_SIZE_WORDS) &&
+                       (IPPROTO_ICMP == ipv4_header.protocol) && ((ipv4_offset+ipv4_total_length) <= packet_size) &&
+                       (ipv4_total_length > ipv4_header_size) );
+
+        if(ipv4_found)
+        {
+          header_sum = 0;
+          for(size_t offset = 0; offset < ipv4_header_size; offset += sizeof(header_word))
+          {
+            memcpy(&header_word, &packet[ipv4_offset+offset], sizeof(header_word));
+            header_sum += ntohs(header_word);
+          }
+          header_sum = (header_sum & IPV4_HALF_WORD_MASK) + (header_sum>>IPV4_HALF_WORD_BITS);
+          header_sum = (header_sum & IPV4_HALF_WORD_MASK) + (header_sum>>IPV4_HALF_WORD_BITS);
+          ipv4_found = (IPV4_HALF_WORD_MASK == header_sum);
+        }
+      }
+    }
+
+    if(ipv4_found)
+    {
+      stats.tx_timestamps++;
+
+      if(tx_timestamp_cb != nullptr)
+      {
+        /* Padding past the IPv4 total length is not part of the ICMP packet */
+        tx_timestamp_cb(ntohl(ipv4_header.daddr), &packet[ipv4_offset+ipv4_header_size], (ipv4_total_length-ipv4_header_size), 
+                        timestamp_from_realtime(&timestamping->ts[0]), tx_timestamp_cb_user_data_ptr);
+      }
+    }
+  }
+}
+
+unsigned int send_engine_c::read_tx_timestamps()
+{
+  unsigned int timestamps = 0;
+  int          ret;
+
+  if(!tx_timestamp_msg.empty())
+  {
+    do
+    {
+      for(unsigned int i = 0; i < tx_timestamp_msg.size(); i++)
+      {
+        tx_timestamp_msg[i].msg_hdr.msg_control    = &tx_timestamp_control[i*SEND_ENGINE_TX_TIMESTAMP_CONTROL_SIZE_BYTES];
+        tx_timestamp_msg[i].msg_hdr.msg_controllen = SEND_ENGINE_TX_TIMESTAMP_CONTROL_SIZE_BYTES;
+        tx_timestamp_msg[i].msg_hdr.msg_flags      = 0;
+      }
+
+      ret = recvmmsg(sockfd, tx_timestamp_msg.data(), (unsigned int)tx_timestamp_msg.size(), (MSG_ERRQUEUE | MSG_DONTWAIT), nullptr);
+
+      for(int i = 0; i < ret; i++)
+      {
+        tx_timestamp(&tx_timestamp_msg[i].msg_hdr, tx_timestamp_msg[i].msg_len);
+        timestamps++;
+      }
+    } while(ret == (int)tx_timestamp_msg.size());
+  }
+
+  return timestamps;
+}
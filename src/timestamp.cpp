@@ -0,0 +1,91 @@
+#include <cstdio>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+#include "timestamp.hpp"
+
+using namespace sandor_laboratories::pingo;
+
+/* Time the TSC is measured against CLOCK_MONOTONIC.  Error of the two clock reads is ~1e-5 of this */
+#define TIMESTAMP_CALIBRATION_NS 20000000UL
+/* CPUID leaf and EDX bit advertising a TSC which runs at a constant rate in every P-, C- and T-state */
+#define TIMESTAMP_CPUID_POWER_MANAGEMENT_LEAF 0x80000007U
+#define TIMESTAMP_CPUID_INVARIANT_TSC_BIT     (1U << 8)
+
+timestamp_calibration_s sandor_laboratories::pingo::timestamp_calibration =
+  {
+    .source      = TIMESTAMP_SOURCE_CLOCK_MONOTONIC,
+    .base_tsc    = 0,
+    .base_ns     = 0,
+    .ns_per_tick = 0,
+  };
+
+#if defined(__x86_64__) || defined(__i386__)
+static bool invariant_tsc()
+{
+  unsigned int eax = 0;
+  unsigned int ebx = 0;
+  unsigned int ecx = 0;
+  unsigned int edx = 0;
+
+  return ( (__get_cpuid_max(0x80000000U, nullptr) >= TIMESTAMP_CPUID_POWER_MANAGEMENT_LEAF) &&
+           (0 != __get_cpuid(TIMESTAMP_CPUID_POWER_MANAGEMENT_LEAF, &eax, &ebx, &ecx, &edx)) &&
+           (0 != (edx & TIMESTAMP_CPUID_INVARIANT_TSC_BIT)) );
+}
+#endif
+
+void sandor_laboratories::pingo::init_timestamp()
+{
+  #if defined(__x86_64__) || defined(__i386__)
+  timestamp_calibration_s calibration = timestamp_calibration;
+  timestamp_ns_t          end_ns;
+  uint64_t                end_tsc;
+
+  if(invariant_tsc())
+  {
+    /* get_timestamp_ns() reads CLOCK_MONOTONIC until the calibration is published */
+    calibration.base_ns  = get_timestamp_ns();
+    calibration.base_tsc = __rdtsc();
+    do
+    {
+      end_ns  = get_timestamp_ns();
+      end_tsc = __rdtsc();
+    } while((end_ns - calibration.base_ns) < TIMESTAMP_CALIBRATION_NS);
+
+    if(end_tsc > calibration.base_tsc)
+    {
+      calibration.ns_per_tick = (uint64_t)((((unsigned __int128)(end_ns - calibration.base_ns)) << 32)/(end_tsc - calibration.base_tsc));
+      calibration.source      = TIMESTAMP_SOURCE_TSC;
+      timestamp_calibration   = calibration;
+    }
+  }
+  #endif
+
+  printf("Timestamps from %s.\n", timestamp_source_string(timestamp_calibration.source));
+}
+
+const char * sandor_laboratories::pingo::timestamp_source_string(timestamp_source_e source)
+{
+  const char * ret_val = "unknown";
+
+  switch(source)
+  {
+    case TIMESTAMP_SOURCE_CLOCK_MONOTONIC:
+    {
+      ret_val = "CLOCK_MONOTONIC";
+      break;
+    }
+    case TIMESTAMP_SOURCE_TSC:
+    {
+      ret_val = "invariant TSC";
+      break;
+    }
+    default:
+    {
+      break;
+    }
+  }
+
+  return ret_val;
+}
@@ -0,0 +1,500 @@
+#include <arpa/inet.h>
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <linux/bpf.h>
+#include <linux/if_link.h>
+#include <netinet/ip.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+#include "pingo.hpp"
+#include "xdp_socket.hpp"
+
+using namespace sandor_laboratories::pingo;
+
+/* Verifier output of a rejected XDP program */
+#define XDP_SOCKET_PROGRAM_LOG_SIZE_BYTES 65536
+
+static int bpf(enum bpf_cmd command, union bpf_attr *attr)
+{
+  return (int) syscall(__NR_bpf, command, attr, sizeof(*attr));
+}
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+static struct bpf_insn bpf_instruction(uint8_t code, uint8_t dst_reg, uint8_t src_reg, int16_t off, int32_t imm)
+{
+  struct bpf_insn instruction;
+
+  memset(&instruction, 0, sizeof(instruction));
+  instruction.code    = code;
+  instruction.dst_reg = dst_reg;
+  instruction.src_reg = src_reg;
+  instruction.off     = off;
+  instruction.imm     = imm;
+
+  return instruction;
+}
+
+static uint32_t next_power_of_two(uint32_t value)
+{
+  uint32_t ret_val = 1;
+
+  while(ret_val < value)
+  {
+    ret_val <<= 1;
+  }
+
+  return ret_val;
+}
+
+// NOLINTBEGIN(readability-magic-numbers)
+void xdp_socket_c::init_config(xdp_socket_config_s *new_config)
+{
+  assert(new_config != nullptr);
+
+  memset(new_config, 0, sizeof(*new_config));
+  new_config->queue      = 0;
+  new_config->copy_mode  = false;
+  new_config->identifier = ICMP_IDENTIFIER;
+  new_config->rx_frames  = XDP_SOCKET_DEFAULT_RX_FRAMES;
+  new_config->tx_frames  = 256;
+}
+// NOLINTEND(readability-magic-numbers)
+
+xdp_socket_c::xdp_socket_c(const xdp_socket_config_s *init_config)
+  : config(*init_config)
+{
+  assert(0 == pthread_mutex_init(&tx_mutex, NULL));
+
+  sockfd              = -1;
+  ifindex             = 0;
+  source_address      = 0;
+  memset(source_mac, 0, sizeof(source_mac));
+  umem                = nullptr;
+  umem_size           = 0;
+  memset(&fill_ring, 0, sizeof(fill_ring));
+  memset(&completion_ring, 0, sizeof(completion_ring));
+  memset(&rx_ring, 0, sizeof(rx_ring));
+  memset(&tx_ring, 0, sizeof(tx_ring));
+  tx_frames_allocated = 0;
+  map_fd              = -1;
+  program_fd          = -1;
+  link_fd             = -1;
+
+  init_interface();
+  init_umem();
+  bind_socket();
+  load_program();
+}
+
+xdp_socket_c::~xdp_socket_c()
+{
+  /* Closing the link detaches the XDP program, replies reach the kernel again */
+  if(link_fd != -1)
+  {
+    close(link_fd);
+  }
+  if(program_fd != -1)
+  {
+    close(program_fd);
+  }
+  if(map_fd != -1)
+  {
+    close(map_fd);
+  }
+  for(xdp_ring_s *ring : {&fill_ring, &completion_ring, &rx_ring, &tx_ring})
+  {
+    if(ring->map != nullptr)
+    {
+      munmap(ring->map, ring->map_size);
+    }
+  }
+  if(sockfd != -1)
+  {
+    close(sockfd);
+  }
+  if(umem != nullptr)
+  {
+    munmap(umem, umem_size);
+  }
+
+  assert(0 == pthread_mutex_destroy(&tx_mutex));
+}
+
+void xdp_socket_c::init_interface()
+{
+  struct ifreq interface_request;
+  const int    inet_sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+
+  /* Frames are built with the interface's own Ethernet and IPv4 address */
+  memset(&interface_request, 0, sizeof(interface_request));
+  /* Left terminated by the memset */
+  memcpy(interface_request.ifr_name, config.interface, strnlen(config.interface, (IF_NAMESIZE-1)));
+  ifindex = if_nametoindex(config.interface);
+  if( (0 == ifindex) || (-1 == inet_sockfd) ||
+      (0 != ioctl(inet_sockfd, SIOCGIFHWADDR, &interface_request)) )
+  {
+    fprintf(stderr, "Failed to find Ethernet address of AF_XDP interface %s.  errno %u: %s\n", config.interface, errno, strerror(errno));
+    safe_exit(1);
+  }
+  memcpy(source_mac, interface_request.ifr_hwaddr.sa_data, ETHER_ADDR_LEN);
+
+  if(0 != ioctl(inet_sockfd, SIOCGIFADDR, &interface_request))
+  {
+    fprintf(stderr, "Failed to find IPv4 address of AF_XDP interface %s.  errno %u: %s\n", config.interface, errno, strerror(errno));
+    safe_exit(1);
+  }
+  source_address = ntohl(((struct sockaddr_in*) &interface_request.ifr_addr)->sin_addr.s_addr);
+
+  close(inet_sockfd);
+}
+
+void xdp_socket_c::map_ring(xdp_ring_s *ring, const struct xdp_ring_offset *offset, uint32_t size, size_t descriptor_size, off_t page_offset)
+{
+  ring->size     = size;
+  ring->map_size = (offset->desc + (size*descriptor_size));
+  ring->map      = mmap(nullptr, ring->map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, sockfd, page_offset);
+  if(MAP_FAILED == ring->map)
+  {
+    fprintf(stderr, "Failed to map AF_XDP ring.  errno %u: %s\n", errno, strerror(errno));
+    ring->map = nullptr;
+    safe_exit(1);
+  }
+
+  ring->producer    = (uint32_t*) &((uint8_t*) ring->map)[offset->producer];
+  ring->consumer    = (uint32_t*) &((uint8_t*) ring->map)[offset->consumer];
+  ring->descriptors = &((uint8_t*) ring->map)[offset->desc];
+  ring->cached_producer = __atomic_load_n(ring->producer, __ATOMIC_ACQUIRE);
+  ring->cached_consumer = __atomic_load_n(ring->consumer, __ATOMIC_ACQUIRE);
+}
+
+void xdp_socket_c::init_umem()
+{
+  const unsigned int      frames       = (config.rx_frames + config.tx_frames);
+  const uint32_t          rx_ring_size = next_power_of_two(config.rx_frames);
+  const uint32_t          tx_ring_size = next_power_of_two(config.tx_frames);
+  struct xdp_umem_reg     umem_registration;
+  struct xdp_mmap_offsets offsets;
+  socklen_t               offsets_size = sizeof(offsets);
+
+  sockfd = socket(AF_XDP, SOCK_RAW, 0);
+  if(-1 == sockfd)
+  {
+    fprintf(stderr, "Failed to open AF_XDP socket.  errno %u: %s\n", errno, strerror(errno));
+    safe_exit((EPERM == errno)?EXIT_STATUS_NO_PERMISSION:1);
+  }
+
+  umem_size = ((size_t)frames*XDP_SOCKET_FRAME_SIZE_BYTES);
+  umem      = (uint8_t*) mmap(nullptr, umem_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if(MAP_FAILED == umem)
+  {
+    fprintf(stderr, "Failed to allocate %lu byte AF_XDP UMEM.  errno %u: %s\n", umem_size, errno, strerror(errno));
+    umem = nullptr;
+    safe_exit(1);
+  }
+
+  memset(&umem_registration, 0, sizeof(umem_registration));
+  umem_registration.addr       = (uint64_t) umem;
+  umem_registration.len        = umem_size;
+  umem_registration.chunk_size = XDP_SOCKET_FRAME_SIZE_BYTES;
+  umem_registration.headroom   = 0;
+
+  if( (0 != setsockopt(sockfd, SOL_XDP, XDP_UMEM_REG, &umem_registration, sizeof(umem_registration))) ||
+      (0 != setsockopt(sockfd, SOL_XDP, XDP_UMEM_FILL_RING, &rx_ring_size, sizeof(rx_ring_size))) ||
+      (0 != setsockopt(sockfd, SOL_XDP, XDP_UMEM_COMPLETION_RING, &tx_ring_size, sizeof(tx_ring_size))) ||
+      (0 != setsockopt(sockfd, SOL_XDP, XDP_RX_RING, &rx_ring_size, sizeof(rx_ring_size))) ||
+      (0 != setsockopt(sockfd, SOL_XDP, XDP_TX_RING, &tx_ring_size, sizeof(tx_ring_size))) ||
+      (0 != getsockopt(sockfd, SOL_XDP, XDP_MMAP_OFFSETS, &offsets, &offsets_size)) )
+  {
+    fprintf(stderr, "Failed to configure AF_XDP UMEM and rings.  errno %u: %s\n", errno, strerror(errno));
+    safe_exit(1);
+  }
+
+  map_ring(&fill_ring,       &offsets.fr, rx_ring_size, sizeof(uint64_t),       XDP_UMEM_PGOFF_FILL_RING);
+  map_ring(&completion_ring, &offsets.cr, tx_ring_size, sizeof(uint64_t),       XDP_UMEM_PGOFF_COMPLETION_RING);
+  map_ring(&rx_ring,         &offsets.rx, rx_ring_size, sizeof(struct xdp_desc), XDP_PGOFF_RX_RING);
+  map_ring(&tx_ring,         &offsets.tx, tx_ring_size, sizeof(struct xdp_desc), XDP_PGOFF_TX_RING);
+
+  /* Every receive frame starts out lent to the kernel */
+  for(unsigned int i = 0; i < config.rx_frames; i++)
+  {
+    ((uint64_t*) fill_ring.descriptors)[fill_ring.cached_producer & (fill_ring.size-1)] = ((uint64_t)i*XDP_SOCKET_FRAME_SIZE_BYTES);
+    fill_ring.cached_producer++;
+  }
+  __atomic_store_n(fill_ring.producer, fill_ring.cached_producer, __ATOMIC_RELEASE);
+}
+
+void xdp_socket_c::bind_socket()
+{
+  struct sockaddr_xdp xdp_address;
+
+  memset(&xdp_address, 0, sizeof(xdp_address));
+  xdp_address.sxdp_family   = AF_XDP;
+  xdp_address.sxdp_flags    = (config.copy_mode?XDP_COPY:XDP_ZEROCOPY);
+  xdp_address.sxdp_ifindex  = ifindex;
+  xdp_address.sxdp_queue_id = config.queue;
+
+  if(0 != bind(sockfd, (struct sockaddr*) &xdp_address, sizeof(xdp_address)))
+  {
+    fprintf(stderr, "Failed to bind AF_XDP socket to queue %u of %s in %s mode.  errno %u: %s\n",
+      config.queue, config.interface, (config.copy_mode?"copy":"zero-copy"), errno, strerror(errno));
+    safe_exit(1);
+  }
+}
+
+// NOLINTBEGIN(readability-magic-numbers)
+void xdp_socket_c::load_program()
+{
+  union bpf_attr           attr;
+  const uint32_t           map_key = config.queue;
+  const uint32_t           map_value = (uint32_t) sockfd;
+  std::vector<bpf_insn>    program;
+  std::vector<size_t>      pass_jumps;
+  std::vector<char>        log(XDP_SOCKET_PROGRAM_LOG_SIZE_BYTES, 0);
+  /* Packet fields are compared as loaded, in network byte order */
+  const int32_t            ethertype_ipv4_n = htons(ETHERTYPE_IP);
+  const int32_t            fragment_mask_n  = htons(IP_MF | IP_OFFMASK);
+  const int32_t            identifier_n     = htons(config.identifier);
+  const size_t             ethernet_size    = sizeof(struct ether_header);
+
+  memset(&attr, 0, sizeof(attr));
+  attr.map_type    = BPF_MAP_TYPE_XSKMAP;
+  attr.key_size    = sizeof(map_key);
+  attr.value_size  = sizeof(map_value);
+  attr.max_entries = (config.queue+1);
+  map_fd = bpf(BPF_MAP_CREATE, &attr);
+
+  memset(&attr, 0, sizeof(attr));
+  attr.map_fd = (uint32_t) map_fd;
+  attr.key    = (uint64_t) &map_key;
+  attr.value  = (uint64_t) &map_value;
+  attr.flags  = BPF_ANY;
+  if((-1 == map_fd) || (0 != bpf(BPF_MAP_UPDATE_ELEM, &attr)))
+  {
+    fprintf(stderr, "Failed to create XSKMAP for AF_XDP socket.  errno %u: %s\n", errno, strerror(errno));
+    safe_exit((EPERM == errno)?EXIT_STATUS_NO_PERMISSION:1);
+  }
+
+  /* r6 = ctx, r2 = data, r3 = data_end */
+  program.push_back(bpf_instruction(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_6, BPF_REG_1, 0, 0));
+  program.push_back(bpf_instruction(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_2, BPF_REG_6, offsetof(struct xdp_md, data), 0));
+  program.push_back(bpf_instruction(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_3, BPF_REG_6, offsetof(struct xdp_md, data_end), 0));
+  /* Ethernet and fixed IPv4 header in bounds */
+  program.push_back(bpf_instruction(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_4, BPF_REG_2, 0, 0));
+  program.push_back(bpf_instruction(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_4, 0, 0, (int32_t)(ethernet_size + sizeof(struct iphdr))));
+  pass_jumps.push_back(program.size());
+  program.push_back(bpf_instruction(BPF_JMP | BPF_JGT | BPF_X, BPF_REG_4, BPF_REG_3, 0, 0));
+  /* Unfragmented IPv4 ICMP */
+  program.push_back(bpf_instruction(BPF_LDX | BPF_MEM | BPF_H, BPF_REG_5, BPF_REG_2, offsetof(struct ether_header, ether_type), 0));
+  pass_jumps.push_back(program.size());
+  program.push_back(bpf_instruction(BPF_JMP | BPF_JNE | BPF_K, BPF_REG_5, 0, 0, ethertype_ipv4_n));
+  program.push_back(bpf_instruction(BPF_LDX | BPF_MEM | BPF_B, BPF_REG_5, BPF_REG_2, (int16_t)(ethernet_size + offsetof(struct iphdr, protocol)), 0));
+  pass_jumps.push_back(program.size());
+  program.push_back(bpf_instruction(BPF_JMP | BPF_JNE | BPF_K, BPF_REG_5, 0, 0, IPPROTO_ICMP));
+  program.push_back(bpf_instruction(BPF_LDX | BPF_MEM | BPF_H, BPF_REG_5, BPF_REG_2, (int16_t)(ethernet_size + offsetof(struct iphdr, frag_off)), 0));
+  program.push_back(bpf_instruction(BPF_ALU64 | BPF_AND | BPF_K, BPF_REG_5, 0, 0, fragment_mask_n));
+  pass_jumps.push_back(program.size());
+  program.push_back(bpf_instruction(BPF_JMP | BPF_JNE | BPF_K, BPF_REG_5, 0, 0, 0));
+  /* r2 = data + IPv4 header length, ICMP header in bounds */
+  program.push_back(bpf_instruction(BPF_LDX | BPF_MEM | BPF_B, BPF_REG_5, BPF_REG_2, (int16_t)ethernet_size, 0));
+  program.push_back(bpf_instruction(BPF_ALU64 | BPF_AND | BPF_K, BPF_REG_5, 0, 0, 0x0F));
+  program.push_back(bpf_instruction(BPF_ALU64 | BPF_LSH | BPF_K, BPF_REG_5, 0, 0, 2));
+  program.push_back(bpf_instruction(BPF_ALU64 | BPF_ADD | BPF_X, BPF_REG_2, BPF_REG_5, 0, 0));
+  program.push_back(bpf_instruction(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_4, BPF_REG_2, 0, 0));
+  program.push_back(bpf_instruction(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_4, 0, 0, (int32_t)(ethernet_size + 8)));
+  pass_jumps.push_back(program.size());
+  program.push_back(bpf_instruction(BPF_JMP | BPF_JGT | BPF_X, BPF_REG_4, BPF_REG_3, 0, 0));
+  /* Echo reply with our identifier */
+  program.push_back(bpf_instruction(BPF_LDX | BPF_MEM | BPF_B, BPF_REG_5, BPF_REG_2, (int16_t)ethernet_size, 0));
+  pass_jumps.push_back(program.size());
+  program.push_back(bpf_instruction(BPF_JMP | BPF_JNE | BPF_K, BPF_REG_5, 0, 0, 0));
+  program.push_back(bpf_instruction(BPF_LDX | BPF_MEM | BPF_H, BPF_REG_5, BPF_REG_2, (int16_t)(ethernet_size + 4), 0));
+  pass_jumps.push_back(program.size());
+  program.push_back(bpf_instruction(BPF_JMP | BPF_JNE | BPF_K, BPF_REG_5, 0, 0, identifier_n));
+  /* return bpf_redirect_map(&xskmap, ctx->rx_queue_index, XDP_PASS) */
+  program.push_back(bpf_instruction(BPF_LD | BPF_DW | BPF_IMM, BPF_REG_1, BPF_PSEUDO_MAP_FD, 0, map_fd));
+  program.push_back(bpf_instruction(0, 0, 0, 0, 0));
+  program.push_back(bpf_instruction(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_2, BPF_REG_6, offsetof(struct xdp_md, rx_queue_index), 0));
+  program.push_back(bpf_instruction(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_3, 0, 0, XDP_PASS));
+  program.push_back(bpf_instruction(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_redirect_map));
+  program.push_back(bpf_instruction(BPF_JMP | BPF_EXIT, 0, 0, 0, 0));
+  /* Everything else is left to the kernel */
+  for(size_t jump : pass_jumps)
+  {
+    program[jump].off = (int16_t)(program.size() - (jump+1));
+  }
+  program.push_back(bpf_instruction(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_0, 0, 0, XDP_PASS));
+  program.push_back(bpf_instruction(BPF_JMP | BPF_EXIT, 0, 0, 0, 0));
+
+  memset(&attr, 0, sizeof(attr));
+  attr.prog_type = BPF_PROG_TYPE_XDP;
+  attr.insn_cnt  = (uint32_t) program.size();
+  attr.insns     = (uint64_t) program.data();
+  attr.license   = (uint64_t) "GPL";
+  attr.log_level = 1;
+  attr.log_buf   = (uint64_t) log.data();
+  attr.log_size  = (uint32_t) log.size();
+  program_fd = bpf(BPF_PROG_LOAD, &attr);
+  if(-1 == program_fd)
+  {
+    fprintf(stderr, "Failed to load XDP program.  errno %u: %s\n%s\n", errno, strerror(errno), log.data());
+    safe_exit((EPERM == errno)?EXIT_STATUS_NO_PERMISSION:1);
+  }
+
+  memset(&attr, 0, sizeof(attr));
+  attr.link_create.prog_fd        = (uint32_t) program_fd;
+  attr.link_create.target_ifindex = ifindex;
+  attr.link_create.attach_type    = BPF_XDP;
+  attr.link_create.flags          = (config.copy_mode?XDP_FLAGS_SKB_MODE:XDP_FLAGS_DRV_MODE);
+  link_fd = bpf(BPF_LINK_CREATE, &attr);
+  if(-1 == link_fd)
+  {
+    fprintf(stderr, "Failed to attach XDP program to %s.  Another XDP program may be attached.  errno %u: %s\n",
+      config.interface, errno, strerror(errno));
+    safe_exit(1);
+  }
+}
+// NOLINTEND(readability-magic-numbers)
+
+uint64_t xdp_socket_c::allocate_tx_frames(unsigned int count)
+{
+  uint64_t ret_val;
+
+  lock_tx();
+  if((tx_frames_allocated + count) > config.tx_frames)
+  {
+    fprintf(stderr, "AF_XDP UMEM has no room for %u more transmit frames.  allocated %u of %u\n", count, tx_frames_allocated, config.tx_frames);
+    safe_exit(1);
+  }
+  ret_val = (((uint64_t)config.rx_frames + tx_frames_allocated)*XDP_SOCKET_FRAME_SIZE_BYTES);
+  tx_frames_allocated += count;
+  unlock_tx();
+
+  return ret_val;
+}
+
+void xdp_socket_c::lock_tx()
+{
+  assert(0 == pthread_mutex_lock(&tx_mutex));
+}
+void xdp_socket_c::unlock_tx()
+{
+  assert(0 == pthread_mutex_unlock(&tx_mutex));
+}
+
+bool xdp_socket_c::tx_queue(uint64_t frame_address, uint32_t length)
+{
+  bool             ret_val;
+  struct xdp_desc *descriptor;
+
+  if((tx_ring.cached_producer - tx_ring.cached_consumer) >= tx_ring.size)
+  {
+    tx_ring.cached_consumer = __atomic_load_n(tx_ring.consumer, __ATOMIC_ACQUIRE);
+  }
+
+  ret_val = ((tx_ring.cached_producer - tx_ring.cached_consumer) < tx_ring.size);
+  if(ret_val)
+  {
+    descriptor = &((struct xdp_desc*) tx_ring.descriptors)[tx_ring.cached_producer & (tx_ring.size-1)];
+    descriptor->addr    = frame_address;
+    descriptor->len     = length;
+    descriptor->options = 0;
+    tx_ring.cached_producer++;
+  }
+
+  return ret_val;
+}
+
+int xdp_socket_c::tx_kick()
+{
+  int ret_val = 0;
+
+  /* Descriptors must be visible before the producer index moves */
+  __atomic_store_n(tx_ring.producer, tx_ring.cached_producer, __ATOMIC_RELEASE);
+  if(sendto(sockfd, nullptr, 0, MSG_DONTWAIT, nullptr, 0) < 0)
+  {
+    ret_val = errno;
+  }
+
+  return ret_val;
+}
+
+unsigned int xdp_socket_c::tx_complete()
+{
+  const uint32_t producer  = __atomic_load_n(completion_ring.producer, __ATOMIC_ACQUIRE);
+  const uint32_t completed = (producer - completion_ring.cached_consumer);
+
+  /* Senders wait for all of their frames under the TX lock, so completed frames are always the current sender's */
+  completion_ring.cached_consumer = producer;
+  __atomic_store_n(completion_ring.consumer, completion_ring.cached_consumer, __ATOMIC_RELEASE);
+
+  return completed;
+}
+
+ssize_t xdp_socket_c::receive(void *buffer, size_t size, struct sockaddr_in *src_addr, int timeout_ms)
+{
+  ssize_t                ret_val = -1;
+  struct pollfd          readable;
+  const struct xdp_desc *descriptor;
+  const uint8_t         *frame;
+  struct ether_header    ethernet_header;
+  struct iphdr           ipv4_header;
+
+  if(rx_ring.cached_consumer == rx_ring.cached_producer)
+  {
+    rx_ring.cached_producer = __atomic_load_n(rx_ring.producer, __ATOMIC_ACQUIRE);
+  }
+  if(rx_ring.cached_consumer == rx_ring.cached_producer)
+  {
+    readable.fd      = sockfd;
+    readable.events  = POLLIN;
+    readable.revents = 0;
+    poll(&readable, 1, timeout_ms);
+    rx_ring.cached_producer = __atomic_load_n(rx_ring.producer, __ATOMIC_ACQUIRE);
+  }
+
+  if(rx_ring.cached_consumer == rx_ring.cached_producer)
+  {
+    errno = EWOULDBLOCK;
+  }
+  else
+  {
+    descriptor = &((const struct xdp_desc*) rx_ring.descriptors)[rx_ring.cached_consumer & (rx_ring.size-1)];
+    frame      = &umem[descriptor->addr];
+
+    /* XDP program only steers IPv4 ICMP, anything shorter is dropped as empty */
+    ret_val = 0;
+    if(descriptor->len >= (sizeof(ethernet_header) + sizeof(ipv4_header)))
+    {
+      memcpy(&ethernet_header, frame, sizeof(ethernet_header));
+      memcpy(&ipv4_header, &frame[sizeof(ethernet_header)], sizeof(ipv4_header));
+      if(htons(ETHERTYPE_IP) == ethernet_header.ether_type)
+      {
+        ret_val = (ssize_t) MIN((descriptor->len - sizeof(ethernet_header)), size);
+        memcpy(buffer, &frame[sizeof(ethernet_header)], (size_t)ret_val);
+
+        memset(src_addr, 0, sizeof(*src_addr));
+        src_addr->sin_family      = AF_INET;
+        src_addr->sin_addr.s_addr = ipv4_header.saddr;
+      }
+    }
+
+    /* Frame is lent back to the kernel.  Fill ring holds every receive frame so it always has room */
+    ((uint64_t*) fill_ring.descriptors)[fill_ring.cached_producer & (fill_ring.size-1)] =
+      (descriptor->addr & ~((uint64_t)XDP_SOCKET_FRAME_SIZE_BYTES-1));
+    fill_ring.cached_producer++;
+    __atomic_store_n(fill_ring.producer, fill_ring.cached_producer, __ATOMIC_RELEASE);
+
+    rx_ring.cached_consumer++;
+    __atomic_store_n(rx_ring.consumer, rx_ring.cached_consumer, __ATOMIC_RELEASE);
+  }
+
+  return ret_val;
+}